@@ -0,0 +1,278 @@
+// @file:     kernel_bench.cc
+// @author:   Samuel Ng
+// @created:  2021-03-29
+// @license:  GNU LGPL v3
+//
+// @desc:     Microbenchmarks of the cost kernels.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <algorithm>
+#include <random>
+
+#include "spatial.h"
+#include "partitioner/batch.h"
+#include "partitioner/generator.h"
+#include "partitioner/stats.h"
+
+namespace {
+
+  //! A kernel input: an assignment and the net cost records that go with it.
+  struct Sample
+  {
+    QVector<int> assignment;  //!< Block assignment, -1 for unassigned blocks.
+    QVector<int> net_costs;   //!< Net cost records for calcCostDelta.
+    int next_bid;             //!< Block to evaluate a move of.
+  };
+
+  //! Kernel arguments drawn up front so that the timed loop draws nothing.
+  struct Op
+  {
+    int sample;   //!< Index of the sample.
+    int bid;      //!< Block to move.
+    int part;     //!< Partition to move the block to.
+    int nid;      //!< Net to evaluate.
+  };
+
+  //! Return net cost records valid for the given assignment.
+  QVector<int> netCosts(const sp::Graph &graph, const QVector<int> &assignment)
+  {
+    QVector<int> net_costs(graph.numNets());
+    for (int nid=0; nid<graph.numNets(); nid++) {
+      net_costs[nid] = sp::Chip::netCost(nid, graph, assignment);
+    }
+    return net_costs;
+  }
+
+  //! Return balanced random complete assignments.
+  QVector<Sample> randomSamples(const sp::Graph &graph, int count,
+      std::mt19937_64 &rng)
+  {
+    QVector<Sample> samples;
+    for (int i=0; i<count; i++) {
+      Sample s;
+      for (int bid=0; bid<graph.numBlocks(); bid++) {
+        s.assignment.append(bid % 2);
+      }
+      std::shuffle(s.assignment.begin(), s.assignment.end(), rng);
+      s.net_costs = netCosts(graph, s.assignment);
+      s.next_bid = rng() % graph.numBlocks();
+      samples.append(s);
+    }
+    return samples;
+  }
+
+  /*! \brief Return partial assignments as the search visits them.
+   *
+   * Each sample is the prefix of a dive that assigns blocks in ID order to
+   * the cheaper partition with probability 0.8 while keeping the partitions
+   * balanced, cut at a random depth. The next block is the one the search
+   * would branch on.
+   */
+  QVector<Sample> dfsSamples(const sp::Graph &graph, int count,
+      std::mt19937_64 &rng)
+  {
+    int n_blocks = graph.numBlocks();
+    int max_in_part = (n_blocks + 1) / 2;
+    QVector<Sample> samples;
+    for (int i=0; i<count; i++) {
+      Sample s;
+      s.assignment.fill(-1, n_blocks);
+      s.net_costs.fill(-1, graph.numNets());
+      int depth = rng() % n_blocks;
+      int counts[2] = {0, 0};
+      for (int bid=0; bid<depth; bid++) {
+        int delta[2];
+        for (int part : {0, 1}) {
+          delta[part] = sp::Chip::calcCostDelta(graph, s.assignment, bid, part,
+              s.net_costs);
+        }
+        int part = (delta[1] < delta[0]) ? 1 : 0;
+        if (rng() % 5 == 0) {
+          part = 1 - part;
+        }
+        if (counts[part] >= max_in_part) {
+          part = 1 - part;
+        }
+        s.assignment[bid] = part;
+        counts[part]++;
+      }
+      s.next_bid = depth;
+      samples.append(s);
+    }
+    return samples;
+  }
+
+  //! Timing settings.
+  struct TimingSettings
+  {
+    int warmup;       //!< Untimed repeats before measuring.
+    int repeats;      //!< Timed repeats.
+    qint64 target_ns; //!< Target duration of each repeat.
+  };
+
+  /*! \brief Time a kernel and return the ns/op of each repeat.
+   *
+   * The op count of a repeat is doubled until a repeat takes the target
+   * duration. Kernel results are accumulated into a sink so that calls can't
+   * be optimized away.
+   */
+  template <typename Kernel>
+  QVector<double> timeKernel(Kernel kernel, int n_ops, const TimingSettings &ts)
+  {
+    static volatile qint64 sink = 0;
+    QElapsedTimer timer;
+    auto batch = [&](qint64 ops) {
+      qint64 acc = 0;
+      timer.start();
+      for (qint64 i=0; i<ops; i++) {
+        acc += kernel(int(i % n_ops));
+      }
+      qint64 ns = timer.nsecsElapsed();
+      sink = sink + acc;
+      return ns;
+    };
+
+    qint64 ops = 1;
+    while (batch(ops) < ts.target_ns && ops < (qint64(1) << 40)) {
+      ops *= 2;
+    }
+    for (int i=0; i<ts.warmup; i++) {
+      batch(ops);
+    }
+    QVector<double> ns_per_op;
+    for (int i=0; i<ts.repeats; i++) {
+      ns_per_op.append(double(batch(ops)) / ops);
+    }
+    return ns_per_op;
+  }
+
+}
+
+int main(int argc, char **argv) {
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("Partitioner Kernel Benchmarks");
+
+  // specify possible command line inputs
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Times the cost kernels on bundled and "
+      "synthetic graphs and reports ns/op.");
+  parser.addHelpOption();
+  parser.addOption({"inputs", "Directory or manifest of netlists to run. "
+      "Defaults to the bundled benchmarks.", "dir_or_manifest",
+      ":/benchmarks"});
+  parser.addOption({"gen-spec", "Synthetic netlist to include, see "
+      "partitioner --gen-spec. May be given several times, defaults to 1000 "
+      "and 10000 block netlists.", "spec"});
+  parser.addOption({"warmup", "Untimed repeats before measuring. Defaults "
+      "to 2.", "n", "2"});
+  parser.addOption({"repeats", "Timed repeats. Defaults to 10.", "n", "10"});
+  parser.addOption({"target-ms", "Duration of each repeat in ms. Defaults "
+      "to 20.", "ms", "20"});
+  parser.addOption({"samples", "Assignments sampled per graph and kind. "
+      "Defaults to 256.", "n", "256"});
+  parser.addOption({"output", "File to write a JSON report to.", "file"});
+  parser.process(app);
+
+  TimingSettings ts;
+  ts.warmup = parser.value("warmup").toInt();
+  ts.repeats = qMax(1, parser.value("repeats").toInt());
+  ts.target_ns = parser.value("target-ms").toLongLong() * 1000000;
+  int n_samples = qMax(1, parser.value("samples").toInt());
+
+  // collect graphs
+  QList<QPair<QString, sp::Graph>> graphs;
+  for (const QString &path : pt::BatchRunner::collectInputs(parser.value("inputs"))) {
+    graphs.append({QFileInfo(path).fileName(), sp::Graph(path)});
+  }
+  QStringList specs = parser.values("gen-spec");
+  if (specs.isEmpty()) {
+    specs << "blocks=1000,nets=1500,rent=0.6" << "blocks=10000,nets=15000,rent=0.6";
+  }
+  for (const QString &spec : specs) {
+    pt::GenSettings gen;
+    if (!pt::GenSettings::fromSpec(spec, gen)) {
+      return 1;
+    }
+    graphs.append({gen.toSpec(), pt::Generator(gen).generate()});
+  }
+
+  QJsonArray results;
+  QTextStream out(stdout);
+  out << QString("%1 %2 %3 %4 %5 %6\n").arg("graph", -40).arg("samples", -7)
+    .arg("kernel", -14).arg("median", 10).arg("min", 10).arg("cv", 7);
+  for (const auto &named_graph : graphs) {
+    const sp::Graph &graph = named_graph.second;
+    if (!graph.isValid() || graph.numBlocks() < 2 || graph.numNets() < 1) {
+      qWarning() << "Skipping unusable graph" << named_graph.first;
+      continue;
+    }
+    std::mt19937_64 rng(1);
+    QList<QPair<QString, QVector<Sample>>> kinds;
+    kinds.append({"random", randomSamples(graph, n_samples, rng)});
+    kinds.append({"dfs", dfsSamples(graph, n_samples, rng)});
+
+    for (auto &kind : kinds) {
+      QVector<Sample> &samples = kind.second;
+      QVector<Op> ops;
+      for (int i=0; i<4096; i++) {
+        Op op;
+        op.sample = rng() % samples.size();
+        op.bid = samples[op.sample].next_bid;
+        op.part = rng() % 2;
+        op.nid = rng() % graph.numNets();
+        ops.append(op);
+      }
+
+      // kernels under test, replacements are added here to compare them
+      QList<QPair<QString, QVector<double>>> timings;
+      timings.append({"calcCost", timeKernel([&](int i) {
+            return sp::Chip::calcCost(graph, samples[ops[i].sample].assignment);
+          }, ops.size(), ts)});
+      timings.append({"calcCostDelta", timeKernel([&](int i) {
+            Sample &s = samples[ops[i].sample];
+            return sp::Chip::calcCostDelta(graph, s.assignment, ops[i].bid,
+                ops[i].part, s.net_costs);
+          }, ops.size(), ts)});
+      timings.append({"netCost", timeKernel([&](int i) {
+            return sp::Chip::netCost(ops[i].nid, graph,
+                samples[ops[i].sample].assignment);
+          }, ops.size(), ts)});
+
+      for (const auto &timing : timings) {
+        pt::SampleStats stats = pt::SampleStats::of(timing.second);
+        out << QString("%1 %2 %3 %4 %5 %6\n").arg(named_graph.first, -40)
+          .arg(kind.first, -7).arg(timing.first, -14)
+          .arg(stats.median, 10, 'f', 2).arg(stats.min, 10, 'f', 2)
+          .arg(stats.cv(), 7, 'f', 3);
+        out.flush();
+        QJsonObject obj;
+        obj["graph"] = named_graph.first;
+        obj["samples"] = kind.first;
+        obj["kernel"] = timing.first;
+        obj["num_blocks"] = graph.numBlocks();
+        obj["num_nets"] = graph.numNets();
+        obj["ns_per_op"] = stats.toJson();
+        results.append(obj);
+      }
+    }
+  }
+
+  if (parser.isSet("output")) {
+    QJsonObject report;
+    report["schema"] = QString("partitioner-kernel-bench");
+    report["schema_version"] = 1;
+    report["warmup"] = ts.warmup;
+    report["repeats"] = ts.repeats;
+    report["results"] = results;
+    QSaveFile f(parser.value("output"));
+    QByteArray bytes = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (!f.open(QIODevice::WriteOnly) || f.write(bytes) != bytes.size()
+        || !f.commit()) {
+      qWarning() << "Failed to write report to" << parser.value("output");
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+// @file:     partitioner_bench.cc
+// @author:   Samuel Ng
+// @created:  2021-03-29
+// @license:  GNU LGPL v3
+//
+// @desc:     Throughput and scaling benchmarks for the partitioner.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <cmath>
+
+#include "partitioner/bench.h"
+#include "partitioner/batch.h"
+#include "partitioner/pjson.h"
+#include "partitioner/alloccount.h"
+
+namespace {
+
+  //! Read a JSON object from file, returns an empty object on failure.
+  QJsonObject readJson(const QString &f_path)
+  {
+    QFile f(f_path);
+    if (!f.open(QIODevice::ReadOnly)) {
+      qWarning() << "Unable to open" << f_path;
+      return QJsonObject();
+    }
+    return QJsonDocument::fromJson(f.readAll()).object();
+  }
+
+}
+
+int main(int argc, char **argv) {
+  QCoreApplication app(argc, argv);
+  app.setApplicationName("Partitioner Benchmarks");
+
+  // specify possible command line inputs
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Runs netlists across thread counts and "
+      "engine settings and reports throughput and parallel efficiency.");
+  parser.addHelpOption();
+  parser.addOption({"inputs", "Directory or manifest of netlists to run. "
+      "Defaults to the bundled benchmarks.", "dir_or_manifest",
+      ":/benchmarks"});
+  parser.addOption({"threads", "Comma separated thread counts to run. "
+      "Defaults to 1,2,4.", "counts", "1,2,4"});
+  parser.addOption({"config", "JSON settings file to benchmark, named after "
+      "the file. May be given several times, the default settings are used "
+      "if unspecified.", "file"});
+  parser.addOption({"time-limit", "Wall time limit of each run in seconds. "
+      "Defaults to 30.", "seconds", "30"});
+  parser.addOption({"node-limit", "Node limit of each run.", "n"});
+  parser.addOption({"output", "File to write the JSON report to, stdout if "
+      "unspecified.", "file"});
+  parser.addOption({"baseline", "Compare against the specified report and "
+      "exit with status 2 on regressions.", "file"});
+  parser.addOption({"tolerance", "Allowed slowdown relative to the baseline "
+      "as a fraction. Defaults to 0.1.", "fraction", "0.1"});
+  parser.addOption({"min-time", "Wall time in ms below which runs are too "
+      "noisy to compare by time. Defaults to 50.", "ms", "50"});
+  parser.addOption({"hw-counters", "Count cycles, instructions, cache misses "
+      "and branch misses of each worker where the kernel allows it, and report "
+      "them per expanded node."});
+  parser.addOption({"max-allocs-per-node", "Exit with status 2 if the search "
+      "loop allocates more than this many times per expanded node after "
+      "warming up, 0 asserts that it doesn't allocate. Requires a build with "
+      "ALLOC_ACCOUNTING.", "n"});
+  parser.process(app);
+  if (parser.isSet("max-allocs-per-node") && !pt::AllocAccounting::enabled()) {
+    qWarning() << "--max-allocs-per-node needs a build with ALLOC_ACCOUNTING";
+    return 1;
+  }
+
+  // engine configs
+  QList<pt::BenchConfig> configs;
+  for (const QString &path : parser.values("config")) {
+    QJsonObject obj = readJson(path);
+    if (obj.isEmpty()) {
+      return 1;
+    }
+    configs.append({QFileInfo(path).completeBaseName(),
+        pt::PJson::settingsFromJson(obj)});
+  }
+  if (configs.isEmpty()) {
+    configs.append({"default", pt::PSettings()});
+  }
+  for (pt::BenchConfig &config : configs) {
+    config.settings.time_limit = std::llround(
+        parser.value("time-limit").toDouble() * 1000);
+    if (parser.isSet("node-limit")) {
+      config.settings.node_limit = parser.value("node-limit").toULongLong();
+    }
+    config.settings.hw_counters = config.settings.hw_counters
+      || parser.isSet("hw-counters");
+  }
+
+  QVector<int> thread_counts;
+  for (const QString &count : parser.value("threads").split(',')) {
+    int threads = count.toInt();
+    if (threads < 1) {
+      qWarning() << "Invalid thread count" << count;
+      return 1;
+    }
+    thread_counts.append(threads);
+  }
+
+  QStringList in_paths = pt::BatchRunner::collectInputs(parser.value("inputs"));
+  if (in_paths.isEmpty()) {
+    qWarning() << "No netlists found in" << parser.value("inputs");
+    return 1;
+  }
+
+  // run and report
+  pt::BenchSuite suite(in_paths, configs, thread_counts);
+  bool ok = suite.run();
+  QJsonObject report = suite.toJson();
+  QByteArray report_bytes = QJsonDocument(report).toJson(QJsonDocument::Indented);
+  if (parser.isSet("output")) {
+    QSaveFile f(parser.value("output"));
+    if (!f.open(QIODevice::WriteOnly) || f.write(report_bytes) != report_bytes.size()
+        || !f.commit()) {
+      qWarning() << "Failed to write report to" << parser.value("output");
+      return 1;
+    }
+  } else {
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+    out.write(report_bytes);
+  }
+
+  // compare against the baseline
+  QStringList regressions;
+  if (parser.isSet("baseline")) {
+    QJsonObject baseline = readJson(parser.value("baseline"));
+    if (baseline["schema_version"].toInt() != pt::BenchSuite::schema_version) {
+      qWarning() << "Baseline schema version mismatch";
+      return 1;
+    }
+    regressions = pt::BenchSuite::compare(report, baseline,
+        parser.value("tolerance").toDouble(), parser.value("min-time").toLongLong());
+  }
+  if (parser.isSet("max-allocs-per-node")) {
+    regressions += suite.checkAllocs(parser.value("max-allocs-per-node").toDouble());
+  }
+  for (const QString &regression : regressions) {
+    qWarning().noquote() << "Regression:" << regression;
+  }
+  if (!regressions.isEmpty()) {
+    return 2;
+  }
+  if (parser.isSet("baseline")) {
+    qDebug() << "No regressions against" << parser.value("baseline");
+  }
+  return ok ? 0 : 1;
+}
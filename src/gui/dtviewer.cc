@@ -20,12 +20,12 @@ DTViewer::~DTViewer()
   clearProblem();
 }
 
-void DTViewer::showGraph(sp::Graph *graph)
+void DTViewer::showGraph(sp::GraphPtr graph)
 {
   clearProblem();
   graph_ = graph;
 
-  GraphMask *mask = new GraphMask(GraphMask::Explorable, 0, graph->numBlocks(),
+  GraphMask *mask = new GraphMask(GraphMask::Explorable, 0, shownBlocks(),
       {0});
   mask->setGrayOut(gray_state_);
   masks_.append(mask);
@@ -36,7 +36,10 @@ void DTViewer::showGraph(sp::Graph *graph)
 
 void DTViewer::addPruneMask(int bid, const QVector<int> &assignments)
 {
-  GraphMask *mask = new GraphMask(GraphMask::Blocked, bid, graph_->numBlocks(),
+  if (bid > shownBlocks()) {
+    return;
+  }
+  GraphMask *mask = new GraphMask(GraphMask::Blocked, bid, shownBlocks(),
       assignments);
   masks_.append(mask);
   scene_->addItem(mask);
@@ -49,13 +52,13 @@ void DTViewer::clearProblem()
 
   // clear relevant vars
   masks_.clear();
-  graph_ = nullptr;
+  graph_.clear();
 }
 
 void DTViewer::fitProblemInView()
 {
-  if (graph_ != nullptr) {
-    int nb = graph_->numBlocks();
+  if (!graph_.isNull()) {
+    int nb = shownBlocks();
     QRectF rect(0, 0, st::Settings::sf*pow(2, nb+1), st::Settings::sf*(nb+1));
     setSceneRect(rect);
     fitInView(rect);
@@ -72,6 +75,11 @@ void DTViewer::setGrayOut(bool gs)
   repaint();
 }
 
+int DTViewer::shownBlocks() const
+{
+  return std::min(graph_->numBlocks(), st::Settings::dtv_max_depth);
+}
+
 void DTViewer::initDTViewer()
 {
   scene_ = new QGraphicsScene(this);
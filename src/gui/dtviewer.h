@@ -29,7 +29,7 @@ namespace gui {
     ~DTViewer();
 
     //! Instruct viewer to show the provided graph tree.
-    void showGraph(sp::Graph *graph);
+    void showGraph(sp::GraphPtr graph);
 
     //! Instruct viewer to add prune mask.
     void addPruneMask(int bid, const QVector<int> &assignments);
@@ -48,9 +48,12 @@ namespace gui {
     //! Initialize the viewer's GUI elements.
     void initDTViewer();
 
+    //! Return the count of tree levels drawn, clamped for large graphs.
+    int shownBlocks() const;
+
     // Private variables
     QGraphicsScene *scene_=nullptr;   //!< Pointer to the scene object.
-    sp::Graph *graph_=nullptr;        //!< Graph pointer.
+    sp::GraphPtr graph_;              //!< Graph being shown.
     QVector<GraphMask*> masks_;       //!< Graph masks for painting.
     bool gray_state_=false;
   };
@@ -36,6 +36,16 @@ void Invoker::invokePlacement()
   p_set.no_pie = cb_no_pie->isChecked();
   p_set.verbose = cb_verbose->isChecked();
   p_set.sanity_check = cb_sanity_check->isChecked();
+  if (!le_time_limit->text().isEmpty()) {
+    bool ok;
+    double time_limit = le_time_limit->text().toDouble(&ok);
+    if (!ok || time_limit < 0) {
+      qWarning() << "Invalid time limit" << le_time_limit->text()
+        << ", not running the partitioner.";
+      return;
+    }
+    p_set.time_limit = std::llround(time_limit * 1000);
+  }
 
   emit sig_runPartitioner(p_set);
 }
@@ -52,6 +62,13 @@ void Invoker::initGui()
   le_gui_update_batch = new QLineEdit;
   le_gui_update_batch->setText(QString("%1").arg(p_set.gui_update_batch));
 
+  le_time_limit = new QLineEdit;
+  le_time_limit->setPlaceholderText("None");
+  QDoubleValidator *time_validator = new QDoubleValidator(0, 1e9, 3, le_time_limit);
+  time_validator->setNotation(QDoubleValidator::StandardNotation);
+  time_validator->setLocale(QLocale::c());
+  le_time_limit->setValidator(time_validator);
+
   cb_prune_half = new QCheckBox;
   cb_prune_half->setChecked(p_set.prune_half);
 
@@ -72,9 +89,12 @@ void Invoker::initGui()
 
   QPushButton *pb_run_partitioner = new QPushButton("Run");
   pb_run_partitioner->setShortcut(tr("CTRL+R"));
+  QPushButton *pb_stop_partitioner = new QPushButton("Stop");
 
   // init gui elements
   connect(pb_run_partitioner, &QAbstractButton::released, this, &Invoker::invokePlacement);
+  connect(pb_stop_partitioner, &QAbstractButton::released,
+      [this]() {emit sig_stopPartitioner();});
   connect(cb_no_dtv, &QCheckBox::stateChanged,
       [this](int state) {emit sig_grayOutDecisionTree(state);});
 
@@ -82,6 +102,7 @@ void Invoker::initGui()
   QFormLayout *fl_gen = new QFormLayout();
   fl_gen->addRow("Num threads", le_threads);
   fl_gen->addRow("GUI update batch", le_gui_update_batch);
+  fl_gen->addRow("Time limit (s)", le_time_limit);
   // NOTE just leaving this setting always default: fl_gen->addRow("Prune half tree", cb_prune_half);
   fl_gen->addRow("Prune by cost", cb_prune_by_cost);
   fl_gen->addRow("No viewer update", cb_no_dtv);
@@ -92,6 +113,7 @@ void Invoker::initGui()
   QVBoxLayout *vl_main = new QVBoxLayout();
   vl_main->addLayout(fl_gen);
   vl_main->addWidget(pb_run_partitioner);
+  vl_main->addWidget(pb_stop_partitioner);
 
   setLayout(vl_main);
   setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Maximum);
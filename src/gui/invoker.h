@@ -39,6 +39,9 @@ namespace gui {
     //! Emit no GUI update state.
     void sig_grayOutDecisionTree(bool);
 
+    //! Request the running partitioner to stop.
+    void sig_stopPartitioner();
+
   private:
 
     //! Initialize the widget.
@@ -47,6 +50,7 @@ namespace gui {
     // Private variables
     QLineEdit *le_threads;
     QLineEdit *le_gui_update_batch;
+    QLineEdit *le_time_limit;
     QCheckBox *cb_prune_half;
     QCheckBox *cb_prune_by_cost;
     QCheckBox *cb_no_dtv;
@@ -21,8 +21,6 @@ MainWindow::MainWindow(const QString &in_path, QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-  delete graph_;
-  graph_ = nullptr;
 }
 
 void MainWindow::resizeEvent(QResizeEvent *e)
@@ -37,33 +35,34 @@ void MainWindow::readAndShowProblem(const QString &in_path)
   setWindowTitle(tr("%1 - %2").arg(QCoreApplication::applicationName())
       .arg(QFileInfo(in_path).fileName()));
 
-  // read the problem onto the class chip pointer
-  graph_ = new sp::Graph(in_path);
+  // read the problem onto the class chip pointer, renumbering the nets once 
+  // for all runs on it
+  graph_ = sp::GraphPtr(new sp::Graph(sp::Graph(in_path).withLocalNetOrder()));
 
   // show the problem
   dt_viewer_->showGraph(graph_);
   p_viewer_->clearProblem();
-  tchart_->initToGraph(graph_);
+  tchart_->initToGraph(*graph_);
   invoker_->respondToNewGraph(*graph_);
   dw_invoker_->raise();
 }
 
 void MainWindow::runPartitioner(const pt::PSettings &p_settings)
 {
-  if (graph_ == nullptr) {
+  if (graph_.isNull()) {
     qWarning() << "runPlacement invoked when no Chip is present. Aborting.";
     QMessageBox::warning(this, "No Problem Present", "An attempt to run "
         "placement with no loaded problem has been halted.");
     return;
   }
   dt_viewer_->showGraph(graph_); // redraw the graph
-  tchart_->initToGraph(graph_);
+  tchart_->initToGraph(*graph_);
   dw_tchart_->raise();
   qDebug() << "Dispatching partition job.";
   if (partitioner != nullptr) {
     delete partitioner;
   }
-  partitioner = new pt::Partitioner(*graph_, p_settings);
+  partitioner = new pt::Partitioner(graph_, p_settings);
 
   // connect signals
   if (!p_settings.no_dtv) {
@@ -78,13 +77,19 @@ void MainWindow::runPartitioner(const pt::PSettings &p_settings)
         });
   }
   connect(partitioner, &pt::Partitioner::sig_updateTelem,
-      [this](long visited, long pruned, int best_cut)
+      [this](quint64 visited, double pruned, int best_cut, double fraction_done,
+        qint64 eta)
       {
-        tchart_->updateTelemetry(visited, pruned, best_cut);
+        tchart_->updateTelemetry(visited, pruned, best_cut, fraction_done, eta);
         qApp->processEvents();
         });
+  connect(partitioner, &pt::Partitioner::sig_updateStats,
+      [this](const pt::SearchStats &stats, const QVector<quint64> &thread_nodes)
+      {
+        tchart_->updateSearchStats(stats, thread_nodes);
+      });
   connect(partitioner, &pt::Partitioner::sig_bestPart,
-      [this](sp::Graph *graph, const QVector<int> block_part, qint64 elapsed_time)
+      [this](sp::GraphPtr graph, const QVector<int> block_part, qint64 elapsed_time)
       {
         p_viewer_->showGraphPart(graph, block_part);
         tchart_->setElapsedTime(elapsed_time);
@@ -106,6 +111,8 @@ void MainWindow::initGui()
   connect(invoker_, &Invoker::sig_runPartitioner, this, &MainWindow::runPartitioner);
   connect(invoker_, &Invoker::sig_grayOutDecisionTree, 
       [this](bool no_dtv) {dt_viewer_->setGrayOut(no_dtv);});
+  connect(invoker_, &Invoker::sig_stopPartitioner,
+      [this]() {if (partitioner != nullptr) partitioner->cancel();});
 
   // layouts
   QVBoxLayout *vbl = new QVBoxLayout(); // main layout
@@ -54,7 +54,7 @@ namespace gui {
     void loadProblemFromFileDialog();
 
     // Private variables
-    sp::Graph *graph_=nullptr;      //!< Pointer to the current graph.
+    sp::GraphPtr graph_;            //!< The current graph.
     DTViewer *dt_viewer_=nullptr;   //!< Pointer to the binary tree viewer.
     PartViewer *p_viewer_=nullptr;  //!< Partition viewer.
     Invoker *invoker_=nullptr;      //!< Pointer to the Invoker widget.
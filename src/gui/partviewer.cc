@@ -22,7 +22,7 @@ PartViewer::~PartViewer()
   clearProblem();
 }
 
-void PartViewer::showGraphPart(sp::Graph *graph, const QVector<int> &block_part)
+void PartViewer::showGraphPart(sp::GraphPtr graph, const QVector<int> &block_part)
 {
   // clear existing elements first
   clearProblem();
@@ -76,7 +76,7 @@ void PartViewer::showGraphPart(sp::Graph *graph, const QVector<int> &block_part)
   // create GUI primitives for nets
   net_prims_.resize(graph_->numNets());
   for (int nid=0; nid<graph_->numNets(); nid++) {
-    Net *net = new Net(nid, graph_->numNets(), graph_->net(nid), block_locs_, x_divide);
+    Net *net = new Net(nid, graph_->numNets(), graph_->net(nid).toVector(), block_locs_, x_divide);
     net_prims_[nid] = net;
     scene_->addItem(net);
   }
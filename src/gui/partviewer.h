@@ -30,7 +30,7 @@ namespace gui {
     ~PartViewer();
 
     //! Instruct viewer to show the provided graph tree mapped to the partition list.
-    void showGraphPart(sp::Graph *graph, const QVector<int> &block_part);
+    void showGraphPart(sp::GraphPtr graph, const QVector<int> &block_part);
 
     //! Instruct viewer to clear any existing problems.
     void clearProblem();
@@ -46,7 +46,7 @@ namespace gui {
     // Private variables
     int dim_x, dim_y;
     QGraphicsScene *scene_=nullptr;   //!< Pointer to the scene object.
-    sp::Graph *graph_=nullptr;        //!< Graph pointer.
+    sp::GraphPtr graph_;              //!< Graph being shown.
     QVector<QPoint> block_locs_;      //!< Vector of block locations.
     QVector<Net*> net_prims_;         //!< Vector of net primitive pointers.
     QMap<QPair<int,int>,Cell*> cell_prims_; //!< Vector of block primitive pointers.
@@ -5,28 +5,21 @@
   \copyright GNU LGPL v3
   */
 
+#include <cmath>
 #include "graph_mask.h"
 
 using namespace gui;
 
-#define fast_2_pow(expo) ((expo==0) ? 1LL : 1LL << ((quint64)expo))
-
 // GraphHelper implementation
 
 qreal GraphHelper::bottomHorizontalNodes(int bid, int num_blocks)
 {
-  return fast_2_pow(num_blocks-bid);
-  /*
-  return pow(2., num_blocks-bid);
-  */
+  return std::ldexp(1., num_blocks-bid);
 }
 
 qreal GraphHelper::interNodeWidth(int bid, int num_blocks)
 {
-  return bottomHorizontalNodes(0, num_blocks) / fast_2_pow(bid);
-  /*
-  return bottomHorizontalNodes(0, num_blocks) / pow(2., bid);
-  */
+  return std::ldexp(1., num_blocks-bid);
 }
 
 qreal GraphHelper::leftmostNodeOffset(int bid, int num_blocks)
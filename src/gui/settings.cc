@@ -13,6 +13,7 @@ using namespace st;
 
 qreal Settings::sf = 1;
 qreal Settings::sf_grid = 25;
+int Settings::dtv_max_depth = 24;
 
 QList<QColor> Settings::gcols;
 int Settings::gcols_for=0;
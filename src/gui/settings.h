@@ -25,6 +25,9 @@ namespace st {
     //! Graphics viewer scaling factor (how many pixels per grid cell).
     static qreal sf_grid;
 
+    //! Deepest decision tree level drawn, deeper prunes are too small to see.
+    static int dtv_max_depth;
+
     //! \brief Return a generated color.
     //!
     //! Return a color that generated as suitable for the provided index and 
@@ -5,6 +5,8 @@
 //
 // @desc:     Implementation of TelemetryChart.
 
+#include <algorithm>
+#include <cmath>
 #include "telemetrychart.h"
 
 using namespace gui;
@@ -15,23 +17,49 @@ TelemetryChart::TelemetryChart(QWidget *parent)
   initGui();
 }
 
-void TelemetryChart::initToGraph(sp::Graph *graph)
+void TelemetryChart::initToGraph(const sp::Graph &graph)
 {
   clearTelemetries();
-  total_leaves_ = std::round(pow(2, graph->numBlocks()));
-  l_total_leaves_->setText(QString("%1").arg(total_leaves_));
+  total_leaves_ = std::ldexp(1., graph.numBlocks());
+  l_total_leaves_->setText(leafCountText(total_leaves_));
   l_unvisited_->setText(l_total_leaves_->text());
 }
 
-void TelemetryChart::updateTelemetry(quint64 visited, quint64 pruned, int best_cut)
+void TelemetryChart::updateTelemetry(quint64 visited, double pruned, int best_cut,
+    double fraction_done, qint64 eta)
 {
   ps_visited_->setValue((qreal)visited/total_leaves_);
   ps_pruned_->setValue((qreal)pruned/total_leaves_);
-  ps_unvisited_->setValue((qreal)(total_leaves_-visited-pruned)/total_leaves_);
+  ps_unvisited_->setValue(std::max(0., total_leaves_-visited-pruned)/total_leaves_);
   l_curr_best_cut_->setText(QString("%1").arg(best_cut));
   l_visited_->setText(QString("%1").arg(visited));
-  l_pruned_->setText(QString("%1").arg(pruned));
-  l_unvisited_->setText(QString("%1").arg(total_leaves_-visited-pruned));
+  l_pruned_->setText(leafCountText(pruned));
+  l_unvisited_->setText(leafCountText(std::max(0., total_leaves_-visited-pruned)));
+  if (fraction_done >= 0) {
+    l_est_done_->setText(QString("%1%").arg(100 * fraction_done, 0, 'f', 1));
+  }
+  if (eta >= 0) {
+    l_eta_->setText(QString::number(eta / 1000., 'f', 1));
+  }
+}
+
+void TelemetryChart::updateSearchStats(const pt::SearchStats &stats,
+    const QVector<quint64> &thread_nodes)
+{
+  l_expanded_->setText(QString("%1").arg(stats.expanded_nodes));
+  l_prunes_->setText(QString("%1 / %2 / %3")
+      .arg(stats.prunes(pt::ImbalancePrune)).arg(stats.prunes(pt::MirrorPrune))
+      .arg(stats.prunes(pt::CostPrune)));
+  l_max_stack_->setText(QString("%1").arg(stats.max_stack_depth));
+  quint64 total = 0, busiest = 0;
+  for (quint64 nodes : thread_nodes) {
+    total += nodes;
+    busiest = std::max(busiest, nodes);
+  }
+  if (total > 0) {
+    l_thread_load_->setText(QString::number(
+          (double)busiest * thread_nodes.size() / total, 'f', 2));
+  }
 }
 
 void TelemetryChart::clearTelemetries()
@@ -45,6 +73,12 @@ void TelemetryChart::clearTelemetries()
   l_visited_->setText("");
   l_pruned_->setText("");
   l_unvisited_->setText("");
+  l_expanded_->setText("");
+  l_prunes_->setText("");
+  l_max_stack_->setText("");
+  l_thread_load_->setText("");
+  l_est_done_->setText("");
+  l_eta_->setText("");
 }
 
 void TelemetryChart::initGui()
@@ -72,6 +106,12 @@ void TelemetryChart::initGui()
   l_visited_ = new QLabel();
   l_pruned_ = new QLabel();
   l_unvisited_ = new QLabel();
+  l_expanded_ = new QLabel();
+  l_prunes_ = new QLabel();
+  l_max_stack_ = new QLabel();
+  l_thread_load_ = new QLabel();
+  l_est_done_ = new QLabel();
+  l_eta_ = new QLabel();
   QFormLayout *fl_status = new QFormLayout();
   fl_status->addRow("Best cut", l_curr_best_cut_);
   fl_status->addRow("Num leaves", l_total_leaves_);
@@ -79,6 +119,12 @@ void TelemetryChart::initGui()
   fl_status->addRow("Pruned leaves", l_pruned_);
   fl_status->addRow("Unvisited leaves", l_unvisited_);
   fl_status->addRow("Wall time (ms)", l_wall_time_);
+  fl_status->addRow("Expanded nodes", l_expanded_);
+  fl_status->addRow("Prunes (imbalance / mirror / cost)", l_prunes_);
+  fl_status->addRow("Max stack depth", l_max_stack_);
+  fl_status->addRow("Thread load (max / mean)", l_thread_load_);
+  fl_status->addRow("Estimated done", l_est_done_);
+  fl_status->addRow("Estimated time left (s)", l_eta_);
 
   // set layout
   QVBoxLayout *vb = new QVBoxLayout();
@@ -93,3 +139,11 @@ void TelemetryChart::initGui()
   setMinimumSize(300, 300);
   setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Expanding);
 }
+
+QString TelemetryChart::leafCountText(double count)
+{
+  if (count < 9007199254740992.) {  // 2^53
+    return QString::number(count, 'f', 0);
+  }
+  return QString::number(count, 'g', 6);
+}
@@ -12,6 +12,7 @@
 #include <QtWidgets>
 #include <QtCharts>
 #include "spatial.h"
+#include "partitioner/partitioner.h"
 
 namespace gui {
 
@@ -27,10 +28,15 @@ namespace gui {
     TelemetryChart(QWidget *parent=nullptr);
 
     //! Set new problem baseline values.
-    void initToGraph(sp::Graph *graph);
+    void initToGraph(const sp::Graph &graph);
 
-    //! Update visit/pruned values
-    void updateTelemetry(quint64 visited, quint64 pruned, int best_cut);
+    //! Update visit/pruned values and the completion estimates, -1 if unknown.
+    void updateTelemetry(quint64 visited, double pruned, int best_cut,
+        double fraction_done, qint64 eta);
+
+    //! Update search statistics and the per-thread load.
+    void updateSearchStats(const pt::SearchStats &stats,
+        const QVector<quint64> &thread_nodes);
 
     //! Set elapsed time
     void setElapsedTime(qint64 elapsed_time) {l_wall_time_->setText(QString("%1").arg(elapsed_time));}
@@ -43,8 +49,11 @@ namespace gui {
     //! Initialize the widget.
     void initGui();
 
+    //! Format a leaf count, exact below 2^53 and in scientific notation above.
+    static QString leafCountText(double count);
+
     // baseline vars
-    quint64 total_leaves_;        //!< Total number of leaves.
+    double total_leaves_;         //!< Total number of leaves, beyond 2^64 for large graphs.
 
     // chart related vars
     QChartView *chart_view_;  //!< Qt Chart view containing the chart.
@@ -61,6 +70,12 @@ namespace gui {
     QLabel *l_unvisited_;     //!< Unvisited leaf count.
     QLabel *l_curr_best_cut_; //!< Current best cut size.
     QLabel *l_wall_time_;     //!< Wall time.
+    QLabel *l_expanded_;      //!< Expanded node count.
+    QLabel *l_prunes_;        //!< Prune counts by reason.
+    QLabel *l_max_stack_;     //!< Maximum stack depth.
+    QLabel *l_thread_load_;   //!< Busiest thread's nodes relative to the mean.
+    QLabel *l_est_done_;      //!< Estimated fraction of the search done.
+    QLabel *l_eta_;           //!< Estimated time left.
   };
 
 }
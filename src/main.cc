@@ -9,14 +9,59 @@
 #include <QCommandLineParser>
 #include <QMainWindow>
 #include <QDebug>
+#include <cmath>
 
 #include "gui/mainwindow.h"
 #include "partitioner/partitioner.h"
+#include "partitioner/jobs.h"
+#include "partitioner/daemon.h"
+#include "partitioner/batch.h"
+#include "partitioner/pjson.h"
+#include "partitioner/incremental.h"
+#include "partitioner/generator.h"
+#include "partitioner/repeat.h"
+
+namespace {
+
+  //! Return whether the arguments ask for a mode that shows no GUI.
+  bool isHeadless(int argc, char **argv)
+  {
+    const QStringList modes = {"headless", "batch", "daemon", "convert",
+      "generate", "decode-log"};
+    for (int i=1; i<argc; i++) {
+      QString arg = QString::fromLocal8Bit(argv[i]);
+      if (!arg.startsWith("--")) {
+        continue;
+      }
+      if (modes.contains(arg.mid(2).section('=', 0, 0))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! Return a one line summary of a running job's progress.
+  QString progressLine(const pt::PProgress &prog)
+  {
+    double secs = prog.elapsed / 1000.;
+    QString line = QString("[%1 s] %2 nodes (%3 nodes/s), %4 leaves visited, "
+        "%5 pruned, best cut %6").arg(secs, 0, 'f', 1).arg(prog.nodes)
+      .arg(prog.nodes / qMax(secs, 1e-3), 0, 'g', 4).arg(prog.visited_leaves)
+      .arg(prog.pruned_leaves, 0, 'g', 4).arg(prog.best_cut_size);
+    if (prog.fraction_done >= 0 && prog.eta >= 0) {
+      line += QString(", ~%1% done, ETA %2 s").arg(100 * prog.fraction_done, 0, 'f', 1)
+        .arg(prog.eta / 1000., 0, 'g', 4);
+    }
+    return line;
+  }
+
+}
 
 int main(int argc, char **argv) {
-  // initialize QApplication
-  QApplication app(argc, argv);
-  app.setApplicationName("Branch and Bound Partitioning Program");
+  // only GUI runs pay for initializing the widget stack
+  QScopedPointer<QCoreApplication> app(isHeadless(argc, argv)
+      ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+  app->setApplicationName("Branch and Bound Partitioning Program");
 
   // specify possible command line inputs
   QCommandLineParser parser;
@@ -31,9 +76,79 @@ int main(int argc, char **argv) {
       " mode.", "n"});
   parser.addOption({"verbose", "Verbose terminal outputs (only applicable to "
       "headless mode."});
-  parser.addOption({"repeat", "Repeat each benchmark for the specified number "
-      "of times. Defaults to 5 if unspecified.", "repeat"});
-  parser.process(app);
+  parser.addOption({"repeat", "Run the headless problem the specified number "
+      "of times and report wall time and node rate statistics.", "repeat"});
+  parser.addOption({"warmup", "Untimed runs before the repeated runs. "
+      "Defaults to 0 if unspecified.", "n", "0"});
+  parser.addOption({"checkpoint", "Periodically write search checkpoints to the"
+      " specified file (headless mode only).", "file"});
+  parser.addOption({"checkpoint-interval", "Seconds between checkpoints. "
+      "Defaults to 600 if unspecified.", "seconds"});
+  parser.addOption({"resume", "Resume the search from the specified checkpoint "
+      "file, in_file must be the same problem. Any thread count may be used.",
+      "file"});
+  parser.addOption({"time-limit", "Stop the search after the specified wall "
+      "time and report the best cut found so far (headless mode only).",
+      "seconds"});
+  parser.addOption({"node-limit", "Stop the search after processing the "
+      "specified number of decision tree nodes (headless mode only).", "n"});
+  parser.addOption({"cache", "Persistent result cache directory. Proven "
+      "results are returned without searching, and known bounds are used as "
+      "the starting incumbent (headless mode only).", "dir"});
+  parser.addOption({"output", "Headless output format, either \"text\" for a "
+      "summary on stderr or \"json\" for a versioned report with the full "
+      "assignment and per-thread counters on stdout. Defaults to text.",
+      "format", "text"});
+  parser.addOption({"convert", "Convert in_file to the binary netlist format, "
+      "which loads without parsing, write it to the specified file and exit.",
+      "out_file"});
+  parser.addOption({"batch", "Partition every netlist in the specified "
+      "directory or listed in the specified manifest file, one path per line.",
+      "dir_or_manifest"});
+  parser.addOption({"batch-output", "File that batch results are appended to "
+      "as each job finishes, CSV unless the extension is .jsonl. Defaults to "
+      "batch_results.csv if unspecified.", "file"});
+  parser.addOption({"jobs", "Maximum count of batch jobs to run concurrently. "
+      "Defaults to the ideal thread count divided by the threads per job if "
+      "unspecified.", "n"});
+  parser.addOption({"daemon", "Run as a daemon serving partitioning jobs as "
+      "JSON lines on the specified local socket.", "socket"});
+  parser.addOption({"daemon-root", "Directory that daemon clients may name "
+      "problem files in by path. Path requests are refused if unspecified.",
+      "dir"});
+  parser.addOption({"progress-interval", "Interval between progress messages "
+      "in ms. Defaults to 500 for the daemon and 1000 for --progress if "
+      "unspecified.", "ms"});
+  parser.addOption({"progress", "Print a progress line to stderr at every "
+      "progress interval (headless mode only)."});
+  parser.addOption({"diff", "Apply the specified netlist diff to in_file "
+      "before partitioning (headless mode only).", "file"});
+  parser.addOption({"previous", "Warm start from the specified JSON report or "
+      "results of an earlier run of in_file, before any diff is applied "
+      "(headless mode only).", "file"});
+  parser.addOption({"generate", "Write a synthetic netlist to the specified "
+      "file and exit, in the binary format if the extension is .ptnl.",
+      "out_file"});
+  parser.addOption({"gen-spec", "Synthetic netlist parameters as comma "
+      "separated key=value pairs out of blocks, nets, min_size, max_size, "
+      "size_exp, rent, clusters, affinity and seed.", "spec"});
+  parser.addOption({"trace", "Write a Chrome trace of worker and main thread "
+      "activity to the specified file, viewable in chrome://tracing or "
+      "Perfetto (headless mode only).", "file"});
+  parser.addOption({"hw-counters", "Count cycles, instructions, cache misses "
+      "and branch misses of each worker through perf_event_open where the "
+      "kernel allows it (headless mode only)."});
+  parser.addOption({"log-file", "Write the search events of verbose runs to "
+      "the specified file as binary records instead of text on stderr.",
+      "file"});
+  parser.addOption({"log-text", "Write the --log-file events as text lines."});
+  parser.addOption({"log-limits", "Search event sampling and rate limits as "
+      "comma separated type=n[:rate] pairs, keeping one in n events and at "
+      "most rate per second and thread. Types are imbalance, mirror, cost and "
+      "leaf, the default is 1:10000 for each.", "spec"});
+  parser.addOption({"decode-log", "Print a binary event log as text and exit.",
+      "file"});
+  parser.process(*app);
 
   // get input file path
   const QStringList args = parser.positionalArguments();
@@ -43,26 +158,242 @@ int main(int argc, char **argv) {
     qDebug() << QObject::tr("Input file path: %1").arg(in_path);
   }
 
+  // generate a synthetic netlist
+  if (parser.isSet("generate")) {
+    pt::GenSettings gen_settings;
+    if (!pt::GenSettings::fromSpec(parser.value("gen-spec"), gen_settings)) {
+      return 1;
+    }
+    sp::Graph graph = pt::Generator(gen_settings).generate();
+    QString out_path = parser.value("generate");
+    bool binary = QFileInfo(out_path).suffix().toLower() == "ptnl";
+    if (!graph.isValid()
+        || !(binary ? graph.writeBinary(out_path) : graph.writeText(out_path))) {
+      return 1;
+    }
+    qDebug() << QObject::tr("Wrote %1 to %2").arg(gen_settings.toSpec())
+      .arg(out_path);
+    return 0;
+  }
+
+  // print a binary event log
+  if (parser.isSet("decode-log")) {
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+    return pt::EventLog::decode(parser.value("decode-log"), out) ? 0 : 1;
+  }
+
+  // convert to the binary netlist format
+  if (parser.isSet("convert")) {
+    sp::Graph graph(in_path);
+    if (!graph.isValid() || !graph.writeBinary(parser.value("convert"))) {
+      return 1;
+    }
+    qDebug() << QObject::tr("Wrote binary netlist to %1")
+      .arg(parser.value("convert"));
+    return 0;
+  }
+
+  // daemon mode
+  if (parser.isSet("daemon")) {
+    pt::PartitionDaemon daemon;
+    if (parser.isSet("progress-interval")) {
+      daemon.setProgressInterval(parser.value("progress-interval").toInt());
+    }
+    if (parser.isSet("daemon-root")
+        && !daemon.setNetlistRoot(parser.value("daemon-root"))) {
+      return 1;
+    }
+    if (!daemon.listen(parser.value("daemon"))) {
+      return 1;
+    }
+    return app->exec();
+  }
+
+  // headless settings
+  pt::PSettings settings;
+  settings.headless = true;
+  settings.verbose = parser.isSet("verbose");
+  if (parser.isSet("threads")) {
+    int n_th = parser.value("threads").toInt();
+    qDebug() << QString("Running %1 threads").arg(n_th);
+    settings.threads = n_th;
+  }
+  settings.checkpoint_path = parser.value("checkpoint");
+  if (parser.isSet("checkpoint-interval")) {
+    settings.checkpoint_interval = parser.value("checkpoint-interval").toInt();
+  }
+  settings.resume_path = parser.value("resume");
+  if (parser.isSet("time-limit")) {
+    settings.time_limit = std::llround(parser.value("time-limit").toDouble() * 1000);
+  }
+  if (parser.isSet("node-limit")) {
+    settings.node_limit = parser.value("node-limit").toULongLong();
+  }
+  settings.cache_dir = parser.value("cache");
+  settings.trace_path = parser.value("trace");
+  settings.hw_counters = parser.isSet("hw-counters");
+  settings.log_path = parser.value("log-file");
+  settings.log_text = parser.isSet("log-text");
+  settings.log_limits = parser.value("log-limits");
+  QVector<pt::EventLimit> log_limits;
+  if (!pt::EventLog::parseLimits(settings.log_limits, log_limits)) {
+    return 1;
+  }
+
+  // batch mode
+  if (parser.isSet("batch")) {
+    QStringList in_paths = pt::BatchRunner::collectInputs(parser.value("batch"));
+    if (in_paths.isEmpty()) {
+      qWarning() << "No netlists found for batch" << parser.value("batch");
+      return 1;
+    }
+    // checkpoints are per problem and don't apply to batches
+    settings.checkpoint_path.clear();
+    settings.resume_path.clear();
+    settings.trace_path.clear();
+    settings.log_path.clear();
+    QString out_path = parser.isSet("batch-output") 
+      ? parser.value("batch-output") : QString("batch_results.csv");
+    int max_jobs = parser.isSet("jobs") ? parser.value("jobs").toInt() : -1;
+    pt::BatchRunner batch(out_path, max_jobs);
+    int failures = batch.run(in_paths, settings);
+    qDebug() << QObject::tr("Batch of %1 netlists complete with %2 failures, "
+        "results in %3").arg(in_paths.size()).arg(failures).arg(out_path);
+    return (failures == 0) ? 0 : 1;
+  }
+
   // headless mode
   if (parser.isSet("headless")) {
-    pt::PSettings settings;
-    settings.headless = true;
-    settings.verbose = parser.isSet("verbose");
-    if (parser.isSet("threads")) {
-      int n_th = parser.value("threads").toInt();
-      qDebug() << QString("Running %1 threads").arg(n_th);
-      settings.threads = n_th;
-    }
-    pt::PartitionerBusyWrapper p(in_path, settings);
-    pt::PResults results = p.runPartitioner();
+    QString output = parser.value("output");
+    if (output != "text" && output != "json") {
+      qWarning() << "Unknown output format" << output;
+      return 1;
+    }
+    sp::GraphPtr graph;
+    {
+      pt::AllocAccounting::Scope alloc_scope(pt::AllocAccounting::Load);
+      graph.reset(new sp::Graph(in_path));
+    }
+    pt::AllocCounts load_allocs = pt::AllocAccounting::threadCounts(
+        pt::AllocAccounting::Load);
+    if (!graph->isValid()) {
+      qWarning() << "Unable to read a valid netlist from" << in_path;
+      return 1;
+    }
+
+    // incremental re-solve of an edited netlist
+    if (parser.isSet("diff") || parser.isSet("previous")) {
+      pt::NetlistDiff diff;
+      if (parser.isSet("diff") && !pt::NetlistDiff::read(parser.value("diff"), diff)) {
+        return 1;
+      }
+      int removed_count = 0;
+      sp::GraphPtr new_graph(new sp::Graph(diff.apply(*graph, &removed_count)));
+      if (!new_graph->isValid()) {
+        qWarning() << "The netlist diff does not apply to" << in_path;
+        return 1;
+      }
+      if (parser.isSet("previous")) {
+        pt::PreviousSolution prev;
+        if (!pt::PreviousSolution::readJson(parser.value("previous"), prev)) {
+          return 1;
+        }
+        settings = pt::Incremental::warmStart(*graph, *new_graph, diff,
+            removed_count, prev, settings);
+      }
+      graph = new_graph;
+    }
+
+    // repeated runs report timing statistics along with the last results
+    pt::PResults results;
+    pt::RepeatReport repeat_report;
+    bool repeated = parser.isSet("repeat");
+    if (repeated) {
+      int repeats = parser.value("repeat").toInt();
+      if (repeats < 1) {
+        qWarning() << "Invalid repeat count" << parser.value("repeat");
+        return 1;
+      }
+      pt::RepeatRunner repeat_runner(graph, settings);
+      repeat_report = repeat_runner.run(repeats, parser.value("warmup").toInt());
+      results = repeat_report.runs.last();
+    } else {
+      pt::JobHandle job = pt::JobRunner::global()->submit(graph, settings);
+      if (parser.isSet("progress")) {
+        int interval = parser.isSet("progress-interval")
+          ? parser.value("progress-interval").toInt() : 1000;
+        while (!job.waitFor(interval)) {
+          qDebug().noquote() << progressLine(job.progress());
+        }
+      }
+      results = job.result();
+    }
+    if (output == "json") {
+      QJsonObject report = pt::PJson::runToJson(in_path, *graph, settings,
+          results);
+      if (repeated) {
+        report["repeat"] = repeat_report.toJson();
+      }
+      if (pt::AllocAccounting::enabled()) {
+        report["load_allocs"] = pt::PJson::allocsToJson(load_allocs, 0);
+      }
+      QFile out;
+      out.open(stdout, QIODevice::WriteOnly);
+      out.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+      out.close();
+      return 0;
+    }
+    if (repeated) {
+      auto summary = [](const pt::SampleStats &stats, const QString &unit) {
+        return QString("min %1, median %2, mean %3, stddev %4 %5, CV %6%")
+          .arg(stats.min, 0, 'g', 4).arg(stats.median, 0, 'g', 4)
+          .arg(stats.mean, 0, 'g', 4).arg(stats.stddev, 0, 'g', 4).arg(unit)
+          .arg(100 * stats.cv(), 0, 'f', 1);
+      };
+      qDebug().noquote() << QString("%1 runs after %2 warmup runs")
+        .arg(repeat_report.runs.size()).arg(repeat_report.warmup);
+      qDebug().noquote() << "Wall time:" << summary(repeat_report.wall_time, "ms");
+      qDebug().noquote() << "Node rate:" << summary(repeat_report.node_rate, "nodes/s");
+      for (const QString &warning : repeat_report.warnings) {
+        qWarning().noquote() << "Unreliable timings:" << warning;
+      }
+    }
     qDebug() << "Best cut size:" << results.best_cut_size;
+    if (!results.proven_optimal) {
+      qDebug() << "Not proven optimal, lower bound:" << results.lower_bound
+        << "gap:" << results.gap;
+      if (results.eta >= 0) {
+        qDebug().noquote() << QString("Estimated %1% done, %2 s more to complete")
+          .arg(100 * results.fraction_done, 0, 'f', 1).arg(results.eta / 1000., 0, 'g', 4);
+      }
+    }
+    if (pt::AllocAccounting::enabled()) {
+      qDebug().noquote() << QString("Allocations: %1 loading, %2 searching, "
+          "%3 per expanded node in steady state").arg(load_allocs.allocs)
+        .arg(results.search_allocs.allocs)
+        .arg(results.steady_allocs.perNode(results.steady_nodes), 0, 'f', 3);
+    }
+    if (results.hw.isValid()) {
+      QJsonObject hw = pt::PJson::hwCountersToJson(results.hw,
+          results.stats.expanded_nodes);
+      for (auto it=hw.constBegin(); it!=hw.constEnd(); ++it) {
+        qDebug().noquote() << QString("%1: %2").arg(it.key())
+          .arg(it.value().toDouble(), 0, 'g', 4);
+      }
+    }
     return 0;
   }
 
   // show the main GUI
+  if (qobject_cast<QApplication*>(app.data()) == nullptr) {
+    qWarning() << "No GUI is available in this mode, pass --headless to "
+      "partition in_file.";
+    return 1;
+  }
   gui::MainWindow mw(in_path);
   mw.show();
 
   // run app
-  return app.exec();
+  return app->exec();
 }
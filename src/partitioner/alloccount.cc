@@ -0,0 +1,152 @@
+/*!
+  \file alloccount.cc
+  \author Samuel Ng
+  \date 2021-03-31 created
+  \copyright GNU LGPL v3
+  */
+
+#include "alloccount.h"
+
+#if defined(PT_ALLOC_ACCOUNTING) && defined(__GLIBC__)
+#define PT_COUNT_ALLOCS
+#include <cstdlib>
+#include <cerrno>
+#endif
+
+using namespace pt;
+
+namespace {
+
+  //! Counts of one thread, plain data so that no allocation is needed to set them up.
+  struct ThreadAllocs
+  {
+    int phase;
+    quint64 allocs[AllocAccounting::NumPhases];
+    quint64 frees[AllocAccounting::NumPhases];
+    quint64 bytes[AllocAccounting::NumPhases];
+  };
+
+  // initial-exec TLS is reachable from inside malloc without allocating
+  __attribute__((tls_model("initial-exec")))
+  thread_local ThreadAllocs thread_allocs;
+
+}
+
+#ifdef PT_COUNT_ALLOCS
+
+// glibc's own implementations, the wrappers below replace the public symbols
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t n, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+  void *__libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void *ptr);
+}
+
+namespace {
+
+  inline void countAlloc(size_t size)
+  {
+    ThreadAllocs &ta = thread_allocs;
+    ta.allocs[ta.phase]++;
+    ta.bytes[ta.phase] += size;
+  }
+
+  inline void countFree(void *ptr)
+  {
+    if (ptr != nullptr) {
+      thread_allocs.frees[thread_allocs.phase]++;
+    }
+  }
+
+}
+
+extern "C" {
+
+  void *malloc(size_t size)
+  {
+    countAlloc(size);
+    return __libc_malloc(size);
+  }
+
+  void *calloc(size_t n, size_t size)
+  {
+    countAlloc(n * size);
+    return __libc_calloc(n, size);
+  }
+
+  void *realloc(void *ptr, size_t size)
+  {
+    countAlloc(size);
+    return __libc_realloc(ptr, size);
+  }
+
+  void *memalign(size_t alignment, size_t size)
+  {
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+  }
+
+  void *aligned_alloc(size_t alignment, size_t size)
+  {
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+  }
+
+  int posix_memalign(void **ptr, size_t alignment, size_t size)
+  {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+      return EINVAL;
+    }
+    countAlloc(size);
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr != nullptr) ? 0 : ENOMEM;
+  }
+
+  void free(void *ptr)
+  {
+    countFree(ptr);
+    __libc_free(ptr);
+  }
+
+}
+
+#endif
+
+
+// AllocAccounting implementation
+
+bool AllocAccounting::enabled()
+{
+#ifdef PT_COUNT_ALLOCS
+  return true;
+#else
+  return false;
+#endif
+}
+
+AllocCounts AllocAccounting::threadCounts(Phase phase)
+{
+  AllocCounts counts;
+  counts.allocs = thread_allocs.allocs[phase];
+  counts.frees = thread_allocs.frees[phase];
+  counts.bytes = thread_allocs.bytes[phase];
+  return counts;
+}
+
+const char *AllocAccounting::phaseName(Phase phase)
+{
+  static const char *names[NumPhases] = {"other", "load", "search", "gui_emit"};
+  return names[phase];
+}
+
+AllocAccounting::Scope::Scope(Phase phase)
+  : prev_phase_(thread_allocs.phase)
+{
+  thread_allocs.phase = phase;
+}
+
+AllocAccounting::Scope::~Scope()
+{
+  thread_allocs.phase = prev_phase_;
+}
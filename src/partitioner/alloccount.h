@@ -0,0 +1,88 @@
+/*!
+  \file alloccount.h
+  \brief Per-thread, per-phase heap allocation accounting.
+  \author Samuel Ng
+  \date 2021-03-31 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_ALLOCCOUNT_H_
+#define _PT_ALLOCCOUNT_H_
+
+#include <QtCore>
+
+namespace pt {
+
+  //! Heap activity counts.
+  struct AllocCounts
+  {
+    quint64 allocs=0;   //!< Allocations, including reallocations.
+    quint64 frees=0;    //!< Frees of non-null pointers.
+    quint64 bytes=0;    //!< Bytes requested by the allocations.
+
+    //! Return the activity since an earlier snapshot.
+    AllocCounts operator-(const AllocCounts &other) const
+    {
+      AllocCounts diff;
+      diff.allocs = allocs - other.allocs;
+      diff.frees = frees - other.frees;
+      diff.bytes = bytes - other.bytes;
+      return diff;
+    }
+
+    //! Accumulate the activity of another thread.
+    void merge(const AllocCounts &other)
+    {
+      allocs += other.allocs;
+      frees += other.frees;
+      bytes += other.bytes;
+    }
+
+    //! Return the allocations per node, -1 if there are no nodes.
+    double perNode(quint64 nodes) const {return (nodes > 0) ? double(allocs) / nodes : -1;}
+  };
+
+  /*! \brief Heap allocation accounting.
+   *
+   * Built with PT_ALLOC_ACCOUNTING defined (the ALLOC_ACCOUNTING CMake
+   * option) on glibc, malloc and friends are wrapped to count every
+   * allocation of the process, which covers operator new as well as Qt
+   * container storage. Counts are kept per thread and attributed to the
+   * phase the thread is in. Otherwise nothing is counted and all counts
+   * read as zero.
+   */
+  class AllocAccounting
+  {
+  public:
+    //! Phases that allocations are attributed to.
+    enum Phase{Other, Load, Search, GuiEmit, NumPhases};
+
+    //! Return whether allocations are being counted in this build.
+    static bool enabled();
+
+    //! Return the counts of the calling thread in the given phase.
+    static AllocCounts threadCounts(Phase phase);
+
+    //! Return the snake case name of a phase.
+    static const char *phaseName(Phase phase);
+
+    //! Attributes the calling thread's allocations to a phase while in scope.
+    class Scope
+    {
+    public:
+      //! Enter the phase.
+      Scope(Phase phase);
+
+      //! Return to the previous phase.
+      ~Scope();
+
+    private:
+      Q_DISABLE_COPY(Scope)
+
+      int prev_phase_;  //!< Phase to return to.
+    };
+  };
+
+}
+
+#endif
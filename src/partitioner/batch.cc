@@ -0,0 +1,161 @@
+/*!
+  \file batch.cc
+  \author Samuel Ng
+  \date 2021-03-27 created
+  \copyright GNU LGPL v3
+  */
+
+#include "batch.h"
+#include "pjson.h"
+
+using namespace pt;
+
+BatchRunner::BatchRunner(const QString &out_path, int max_jobs)
+  : out_path_(out_path), runner_(max_jobs), max_jobs_(max_jobs)
+{
+  json_lines_ = QFileInfo(out_path).suffix().toLower() == "jsonl";
+}
+
+QStringList BatchRunner::collectInputs(const QString &dir_or_manifest)
+{
+  QStringList paths;
+  QFileInfo info(dir_or_manifest);
+  if (info.isDir()) {
+    QDir dir(dir_or_manifest);
+    for (const QString &name : dir.entryList({"*.txt", "*.ptnl"}, QDir::Files,
+          QDir::Name)) {
+      paths.append(dir.filePath(name));
+    }
+    return paths;
+  }
+
+  QFile f(dir_or_manifest);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    qWarning() << "Unable to open batch manifest" << dir_or_manifest;
+    return paths;
+  }
+  QDir base_dir = info.absoluteDir();
+  while (!f.atEnd()) {
+    QString line = QString::fromUtf8(f.readLine()).trimmed();
+    if (line.isEmpty() || line.startsWith('#')) {
+      continue;
+    }
+    paths.append(QDir::cleanPath(base_dir.filePath(line)));
+  }
+  return paths;
+}
+
+int BatchRunner::run(const QStringList &in_paths, const PSettings &settings)
+{
+  // every job may spawn the configured threads, so don't run more of them
+  // than the cores can take
+  if (max_jobs_ <= 0) {
+    runner_.setMaxConcurrentJobs(qMax(1,
+          QThread::idealThreadCount() / qMax(1, settings.threads)));
+  }
+
+  // rows are written from the job slots as soon as each job finishes
+  int failures = 0;
+  QMetaObject::Connection conn = QObject::connect(&runner_,
+      &JobRunner::sig_jobFinished,
+      [this, &failures](quint64 job_id, const PResults &results) {
+        BatchJob job;
+        {
+          QMutexLocker locker(&mutex_);
+          job = jobs_.take(job_id);
+        }
+        if (!writeRow(job, &results)) {
+          QMutexLocker locker(&mutex_);
+          failures++;
+        }
+      });
+
+  for (const QString &path : in_paths) {
+    sp::GraphPtr graph(new sp::Graph(path));
+    BatchJob job;
+    job.path = path;
+    job.num_blocks = graph->numBlocks();
+    job.num_nets = graph->numNets();
+    job.threads = 0;
+    if (!graph->isValid()) {
+      writeRow(job, nullptr, "invalid netlist");
+      QMutexLocker locker(&mutex_);
+      failures++;
+      continue;
+    }
+
+    // small problems run single-threaded so that more of them fit in the pool
+    PSettings job_settings = settings;
+    if (job.num_blocks < multi_thread_blocks_) {
+      job_settings.threads = 1;
+    }
+    job.threads = job_settings.threads;
+
+    // hold the lock so that the job can't report before it is registered
+    QMutexLocker locker(&mutex_);
+    JobHandle handle = runner_.submit(graph, job_settings);
+    jobs_.insert(handle.id(), job);
+  }
+
+  // futures are fulfilled just before the signal, so wait for the job slots
+  // to drain rather than on the handles to be sure every row is written
+  runner_.waitForDone();
+  QObject::disconnect(conn);
+  return failures;
+}
+
+bool BatchRunner::writeRow(const BatchJob &job, const PResults *results,
+    const QString &error)
+{
+  QMutexLocker locker(&mutex_);
+  QFile f(out_path_);
+  bool new_file = !f.exists() || f.size() == 0;
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    qWarning() << "Unable to open batch output" << out_path_;
+    return false;
+  }
+
+  QByteArray row;
+  if (json_lines_) {
+    QJsonObject obj = (results != nullptr) ? PJson::resultsToJson(*results)
+      : QJsonObject();
+    obj["file"] = job.path;
+    obj["num_blocks"] = job.num_blocks;
+    obj["num_nets"] = job.num_nets;
+    obj["threads"] = job.threads;
+    if (!error.isEmpty()) {
+      obj["error"] = error;
+    }
+    row = QJsonDocument(obj).toJson(QJsonDocument::Compact) + "\n";
+  } else {
+    if (new_file) {
+      row = "file,num_blocks,num_nets,threads,best_cut_size,proven_optimal,"
+        "lower_bound,stop_reason,wall_time,nodes,cached,error\n";
+    }
+    QStringList fields;
+    QString path = job.path;
+    fields << "\"" + path.replace("\"", "\"\"") + "\"";
+    fields << QString::number(job.num_blocks) << QString::number(job.num_nets)
+      << QString::number(job.threads);
+    if (results != nullptr) {
+      fields << QString::number(results->best_cut_size)
+        << (results->proven_optimal ? "true" : "false")
+        << QString::number(results->lower_bound)
+        << PJson::stopReasonName(results->stop_reason)
+        << QString::number(results->wall_time)
+        << QString::number(results->nodes)
+        << (results->cached ? "true" : "false");
+    } else {
+      fields << "" << "" << "" << "" << "" << "" << "";
+    }
+    fields << error;
+    row += fields.join(',').toUtf8() + "\n";
+  }
+
+  // flush each row so that it survives a crash of the batch
+  bool ok = f.write(row) == row.size() && f.flush();
+  if (!ok) {
+    qWarning() << "Failed to write batch row to" << out_path_;
+  }
+  return ok;
+}
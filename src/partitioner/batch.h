@@ -0,0 +1,83 @@
+/*!
+  \file batch.h
+  \brief Partition a directory or manifest of netlists in one process.
+  \author Samuel Ng
+  \date 2021-03-27 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_BATCH_H_
+#define _PT_BATCH_H_
+
+#include <QtCore>
+#include "partitioner/jobs.h"
+
+namespace pt {
+
+  /*! \brief Runs a batch of netlists on a shared job pool.
+   *
+   * Netlists are submitted to a JobRunner so that several small problems run
+   * concurrently while large problems use the configured thread count. One
+   * row is appended to the output file as soon as each job finishes, either
+   * as CSV or as JSON lines depending on the output file extension (".jsonl"
+   * selects JSON lines), so that partial results survive a crash.
+   */
+  class BatchRunner
+  {
+  public:
+    /*! \brief Construct a batch writing rows to the given file.
+     *
+     * If max_jobs isn't positive, as many jobs run at once as fit the ideal
+     * thread count with the configured threads per job.
+     */
+    BatchRunner(const QString &out_path, int max_jobs=-1);
+
+    /*! \brief Collect netlist paths from a directory or a manifest file.
+     *
+     * Directories contribute their "*.txt" and "*.ptnl" files in name order.
+     * Manifests list one path per line relative to the manifest, blank lines
+     * and lines starting with '#' are ignored.
+     */
+    static QStringList collectInputs(const QString &dir_or_manifest);
+
+    /*! \brief Set the block count from which jobs use multiple threads.
+     *
+     * Smaller problems run single-threaded so that more of them fit in the
+     * pool at once.
+     */
+    void setMultiThreadBlocks(int n_blocks) {multi_thread_blocks_ = n_blocks;}
+
+    /*! \brief Run all netlists and wait for them to finish.
+     *
+     * Returns the count of netlists that could not be read or had no result
+     * rows written.
+     */
+    int run(const QStringList &in_paths, const PSettings &settings);
+
+  private:
+
+    //! A job in flight along with what is needed to describe its row.
+    struct BatchJob
+    {
+      QString path;       //!< Netlist path.
+      int num_blocks;     //!< Block count.
+      int num_nets;       //!< Net count.
+      int threads;        //!< Threads given to the job.
+    };
+
+    //! Append a row for the given job, thread-safe.
+    bool writeRow(const BatchJob &job, const PResults *results,
+        const QString &error=QString());
+
+    QString out_path_;          //!< Output file path.
+    bool json_lines_;           //!< Write JSON lines instead of CSV.
+    JobRunner runner_;          //!< Pool running the jobs.
+    int max_jobs_;              //!< Requested concurrent job count, -1 if unset.
+    int multi_thread_blocks_=32;  //!< Block count from which jobs get several threads.
+    QMutex mutex_;              //!< Guards the output file and jobs_.
+    QHash<quint64, BatchJob> jobs_; //!< Jobs in flight by job ID.
+  };
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*!
+  \file bench.cc
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#include "bench.h"
+#include "jobs.h"
+#include "pjson.h"
+
+using namespace pt;
+
+namespace {
+
+  //! Return the key matching runs across reports.
+  QString runKey(const QJsonObject &run)
+  {
+    return QString("%1/%2/%3").arg(run["netlist"].toString())
+      .arg(run["config"].toString()).arg(run["threads"].toInt());
+  }
+
+}
+
+
+// BenchRun implementation
+
+double BenchRun::nodesPerSec() const
+{
+  return results.nodes / (qMax<qint64>(results.wall_time, 1) / 1000.);
+}
+
+
+// BenchSuite implementation
+
+BenchSuite::BenchSuite(const QStringList &in_paths,
+    const QList<BenchConfig> &configs, const QVector<int> &thread_counts)
+  : in_paths_(in_paths), configs_(configs), thread_counts_(thread_counts)
+{
+  for (BenchConfig &config : configs_) {
+    PSettings &settings = config.settings;
+    QStringList cleared;
+    auto clearPath = [&cleared](QString &path, const QString &name) {
+      if (!path.isEmpty()) {
+        cleared.append(name);
+        path.clear();
+      }
+    };
+    clearPath(settings.cache_dir, "cache_dir");
+    clearPath(settings.checkpoint_path, "checkpoint_path");
+    clearPath(settings.resume_path, "resume_path");
+    clearPath(settings.trace_path, "trace_path");
+    clearPath(settings.log_path, "log_path");
+    if (settings.verbose) {
+      cleared.append("verbose");
+      settings.verbose = false;
+    }
+    if (!cleared.isEmpty()) {
+      qWarning() << QString("Config %1: ignoring %2 since they would skew the "
+          "timings.").arg(config.name).arg(cleared.join(", "));
+    }
+  }
+}
+
+bool BenchSuite::run()
+{
+  runs_.clear();
+  bool ok = true;
+  for (const QString &path : in_paths_) {
+    sp::GraphPtr graph(new sp::Graph(path));
+    if (!graph->isValid()) {
+      qWarning() << "Skipping unreadable netlist" << path;
+      ok = false;
+      continue;
+    }
+    for (const BenchConfig &config : configs_) {
+      for (int threads : thread_counts_) {
+        BenchRun run;
+        run.netlist = QFileInfo(path).fileName();
+        run.config = config.name;
+        run.threads = threads;
+        PSettings settings = config.settings;
+        settings.threads = threads;
+        settings.headless = true;
+        run.results = JobRunner::global()->submit(graph, settings).result();
+        qDebug() << QString("%1 %2 %3t: %4 ms, %5 nodes/s, cut %6 (%7)")
+          .arg(run.netlist).arg(run.config).arg(threads)
+          .arg(run.results.wall_time).arg(run.nodesPerSec(), 0, 'g', 4)
+          .arg(run.results.best_cut_size)
+          .arg(PJson::stopReasonName(run.results.stop_reason));
+        runs_.append(run);
+      }
+    }
+  }
+  computeScaling();
+  return ok;
+}
+
+QJsonObject BenchSuite::toJson() const
+{
+  QJsonArray runs;
+  for (const BenchRun &run : runs_) {
+    const PResults &res = run.results;
+    QJsonObject obj;
+    obj["netlist"] = run.netlist;
+    obj["config"] = run.config;
+    obj["threads"] = run.threads;
+    obj["best_cut_size"] = res.best_cut_size;
+    obj["proven_optimal"] = res.proven_optimal;
+    obj["stop_reason"] = PJson::stopReasonName(res.stop_reason);
+    obj["wall_time"] = (double)res.wall_time;
+    obj["cpu_time"] = (double)res.cpu_time;
+    obj["nodes"] = (double)res.nodes;
+    obj["nodes_per_sec"] = run.nodesPerSec();
+    obj["visited_leaves"] = (double)res.visited_leaves;
+    obj["pruned_leaves"] = res.pruned_leaves;
+    obj["speedup"] = run.speedup;
+    obj["efficiency"] = run.efficiency;
+    if (res.hw.isValid()) {
+      obj["hw_counters"] = PJson::hwCountersToJson(res.hw,
+          res.stats.expanded_nodes);
+    }
+    if (AllocAccounting::enabled()) {
+      obj["steady_allocs"] = PJson::allocsToJson(res.steady_allocs,
+          res.steady_nodes);
+    }
+    runs.append(obj);
+  }
+
+  QJsonArray configs;
+  for (const BenchConfig &config : configs_) {
+    QJsonObject obj;
+    obj["name"] = config.name;
+    obj["settings"] = PJson::settingsToJson(config.settings);
+    configs.append(obj);
+  }
+
+  QJsonObject report;
+  report["schema"] = QString("partitioner-bench");
+  report["schema_version"] = schema_version;
+  report["ideal_threads"] = QThread::idealThreadCount();
+  report["configs"] = configs;
+  report["runs"] = runs;
+  return report;
+}
+
+QStringList BenchSuite::compare(const QJsonObject &report,
+    const QJsonObject &baseline, double tolerance, qint64 min_time)
+{
+  QHash<QString, QJsonObject> base_runs;
+  for (const QJsonValue &val : baseline["runs"].toArray()) {
+    base_runs.insert(runKey(val.toObject()), val.toObject());
+  }
+
+  QStringList regressions;
+  for (const QJsonValue &val : report["runs"].toArray()) {
+    QJsonObject run = val.toObject();
+    QString key = runKey(run);
+    if (!base_runs.contains(key)) {
+      continue;
+    }
+    QJsonObject base = base_runs[key];
+
+    if (run["proven_optimal"].toBool() && base["proven_optimal"].toBool()
+        && run["best_cut_size"].toInt() != base["best_cut_size"].toInt()) {
+      regressions.append(QString("%1: optimal cut %2 differs from baseline %3")
+          .arg(key).arg(run["best_cut_size"].toInt())
+          .arg(base["best_cut_size"].toInt()));
+      continue;
+    }
+
+    bool completed = run["stop_reason"].toString() == "completed"
+      && base["stop_reason"].toString() == "completed";
+    if (completed) {
+      double time = run["wall_time"].toDouble();
+      double base_time = base["wall_time"].toDouble();
+      if (qMax(time, base_time) >= min_time && time > base_time * (1 + tolerance)) {
+        regressions.append(QString("%1: wall time %2 ms exceeds baseline %3 ms")
+            .arg(key).arg(time).arg(base_time));
+      }
+    } else {
+      double rate = run["nodes_per_sec"].toDouble();
+      double base_rate = base["nodes_per_sec"].toDouble();
+      if (rate < base_rate / (1 + tolerance)) {
+        regressions.append(QString("%1: %2 nodes/s is below baseline %3 nodes/s")
+            .arg(key).arg(rate, 0, 'g', 4).arg(base_rate, 0, 'g', 4));
+      }
+    }
+  }
+  return regressions;
+}
+
+QStringList BenchSuite::checkAllocs(double max_per_node) const
+{
+  QStringList failures;
+  for (const BenchRun &run : runs_) {
+    double per_node = run.results.steady_allocs.perNode(run.results.steady_nodes);
+    if (per_node > max_per_node) {
+      failures.append(QString("%1/%2/%3: %4 allocations per node in the steady "
+            "state search loop").arg(run.netlist).arg(run.config)
+          .arg(run.threads).arg(per_node, 0, 'g', 4));
+    }
+  }
+  return failures;
+}
+
+void BenchSuite::computeScaling()
+{
+  QHash<QString, const BenchRun*> single;
+  for (const BenchRun &run : runs_) {
+    if (run.threads == 1) {
+      single.insert(run.netlist + "/" + run.config, &run);
+    }
+  }
+  for (BenchRun &run : runs_) {
+    const BenchRun *base = single.value(run.netlist + "/" + run.config);
+    if (base == nullptr) {
+      continue;
+    }
+    bool completed = run.results.stop_reason == Completed
+      && base->results.stop_reason == Completed;
+    if (completed) {
+      run.speedup = double(qMax<qint64>(base->results.wall_time, 1))
+        / qMax<qint64>(run.results.wall_time, 1);
+    } else {
+      run.speedup = run.nodesPerSec() / base->nodesPerSec();
+    }
+    run.efficiency = run.speedup / run.threads;
+  }
+}
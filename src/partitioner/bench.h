@@ -0,0 +1,103 @@
+/*!
+  \file bench.h
+  \brief Throughput and scaling benchmarks with baseline comparisons.
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_BENCH_H_
+#define _PT_BENCH_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  //! A named set of engine settings to benchmark.
+  struct BenchConfig
+  {
+    QString name;         //!< Name used to match runs against baselines.
+    PSettings settings;   //!< Engine settings, threads are overridden.
+  };
+
+  //! Measurements of one netlist, config and thread count.
+  struct BenchRun
+  {
+    QString netlist;      //!< Netlist file name.
+    QString config;       //!< Config name.
+    int threads=1;        //!< Requested thread count.
+    PResults results;     //!< Engine results.
+    double speedup=-1;    //!< Speedup over one thread, -1 if unknown.
+    double efficiency=-1; //!< Speedup divided by the thread count, -1 if unknown.
+
+    //! Return the processed nodes per second of wall time.
+    double nodesPerSec() const;
+  };
+
+  /*! \brief Runs netlists across configs and thread counts.
+   *
+   * Runs are executed one at a time so that they don't compete for cores.
+   * Parallel efficiency is computed against the single thread run of the
+   * same netlist and config, from wall times when both runs completed and
+   * from node throughput when either hit a budget.
+   */
+  class BenchSuite
+  {
+  public:
+    //! Version of the benchmark report schema, bumped on incompatible changes.
+    static const int schema_version = 1;
+
+    /*! \brief Construct a suite over the given netlist paths.
+     *
+     * Settings that would skew the timings, the result cache, checkpoints,
+     * tracing and verbose logging, are cleared from the configs with a
+     * warning.
+     */
+    BenchSuite(const QStringList &in_paths, const QList<BenchConfig> &configs,
+        const QVector<int> &thread_counts);
+
+    //! Run every combination, returns false if a netlist could not be read.
+    bool run();
+
+    //! Return the runs so far.
+    const QList<BenchRun> &runs() const {return runs_;}
+
+    //! Return a JSON report of the runs.
+    QJsonObject toJson() const;
+
+    /*! \brief Compare a report against a baseline report.
+     *
+     * Runs are matched by netlist, config and thread count. A run regresses
+     * if it takes more than (1 + tolerance) times the baseline wall time, or
+     * if its node throughput falls below the baseline divided by
+     * (1 + tolerance) when either run hit a budget. Runs where both wall
+     * times are below min_time ms are too noisy to compare by time. A
+     * proven optimal cut that differs from a proven baseline cut is always
+     * reported. Returns one message per regression.
+     */
+    static QStringList compare(const QJsonObject &report,
+        const QJsonObject &baseline, double tolerance, qint64 min_time=50);
+
+    /*! \brief Check the steady state heap activity of the search loop.
+     *
+     * Returns one message per run whose workers allocate more than
+     * max_per_node times per expanded node after their first budget check.
+     * Only meaningful when AllocAccounting is enabled.
+     */
+    QStringList checkAllocs(double max_per_node) const;
+
+  private:
+
+    //! Fill in speedups and efficiencies from the single thread runs.
+    void computeScaling();
+
+    QStringList in_paths_;          //!< Netlist paths.
+    QList<BenchConfig> configs_;    //!< Configs to run.
+    QVector<int> thread_counts_;    //!< Thread counts to run.
+    QList<BenchRun> runs_;          //!< Completed runs.
+  };
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*!
+  \file checkpoint.cc
+  \author Samuel Ng
+  \date 2021-03-20 created
+  \copyright GNU LGPL v3
+  */
+
+#include "checkpoint.h"
+
+using namespace pt;
+
+namespace {
+
+  const quint32 ckpt_magic = 0x50544350;  // "PTCP"
+  const quint32 ckpt_version = 2;  // version 1 stored pruned leaves as quint64
+
+  //! Pack the first n entries of a 0/1 assignment into bits.
+  QByteArray packBits(const QVector<int> &assignment, int n)
+  {
+    QByteArray bits((n+7)/8, '\0');
+    for (int i=0; i<n; i++) {
+      if (assignment[i] == 1) {
+        bits[i/8] = bits[i/8] | (char)(1 << (i%8));
+      }
+    }
+    return bits;
+  }
+
+  //! Unpack n bits into the front of an assignment, leaving the rest at -1.
+  QVector<int> unpackBits(const QByteArray &bits, int n, int num_blocks)
+  {
+    QVector<int> assignment(num_blocks, -1);
+    for (int i=0; i<n; i++) {
+      assignment[i] = (bits[i/8] >> (i%8)) & 1;
+    }
+    return assignment;
+  }
+
+}
+
+bool Checkpoint::write(const QString &f_path) const
+{
+  // write to a temporary file and commit at the end so that a preemption in
+  // the middle of writing never destroys the previous checkpoint
+  QSaveFile f(f_path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to open checkpoint file for writing:" << f_path;
+    return false;
+  }
+
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_5_2);
+  out << ckpt_magic << ckpt_version;
+  out << (qint32)num_blocks << (qint32)num_nets << graph_hash;
+  out << visited_leaves << pruned_leaves;
+  out << (qint32)best_cost;
+  if (best_cost >= 0) {
+    QByteArray bits = packBits(best_assignment, num_blocks);
+    out.writeRawData(bits.constData(), bits.size());
+  }
+  out << (quint32)frontier.size();
+  for (const ProblemNodeParams &p : frontier) {
+    out << (quint32)p.bid << (qint32)p.cut_size;
+    QByteArray bits = packBits(p.assignment, p.bid);
+    out.writeRawData(bits.constData(), bits.size());
+  }
+
+  if (out.status() != QDataStream::Ok || !f.commit()) {
+    qWarning() << "Failed to write checkpoint file:" << f_path;
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint::read(const QString &f_path, Checkpoint &ckpt)
+{
+  QFile f(f_path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    qWarning() << "Unable to open checkpoint file for reading:" << f_path;
+    return false;
+  }
+
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_5_2);
+  quint32 magic, version;
+  in >> magic >> version;
+  if (magic != ckpt_magic || version < 1 || version > ckpt_version) {
+    qWarning() << "Not a supported checkpoint file:" << f_path;
+    return false;
+  }
+
+  qint32 num_blocks, num_nets, best_cost;
+  in >> num_blocks >> num_nets >> ckpt.graph_hash;
+  in >> ckpt.visited_leaves;
+  if (version == 1) {
+    quint64 pruned_leaves;
+    in >> pruned_leaves;
+    ckpt.pruned_leaves = pruned_leaves;
+  } else {
+    in >> ckpt.pruned_leaves;
+  }
+  in >> best_cost;
+  if (in.status() != QDataStream::Ok || num_blocks < 0 || num_nets < 0) {
+    qWarning() << "Corrupted checkpoint header in" << f_path;
+    return false;
+  }
+  ckpt.num_blocks = num_blocks;
+  ckpt.num_nets = num_nets;
+  ckpt.best_cost = best_cost;
+  ckpt.best_assignment.clear();
+  if (best_cost >= 0) {
+    QByteArray bits((num_blocks+7)/8, '\0');
+    in.readRawData(bits.data(), bits.size());
+    ckpt.best_assignment = unpackBits(bits, num_blocks, num_blocks);
+  }
+
+  quint32 frontier_size;
+  in >> frontier_size;
+  ckpt.frontier.clear();
+  ckpt.frontier.reserve(frontier_size);
+  QVector<int> net_costs(num_nets, -1); // shared by all restored nodes
+  for (quint32 i=0; i<frontier_size && in.status() == QDataStream::Ok; i++) {
+    quint32 bid;
+    qint32 cut_size;
+    in >> bid >> cut_size;
+    if ((int)bid > num_blocks) {
+      qWarning() << "Corrupted checkpoint frontier entry in" << f_path;
+      return false;
+    }
+    QByteArray bits((bid+7)/8, '\0');
+    in.readRawData(bits.data(), bits.size());
+    ProblemNodeParams p = ProblemNodeParams::fromPrefix(
+        unpackBits(bits, bid, num_blocks), bid, net_costs);
+    p.cut_size = cut_size;
+    ckpt.frontier.append(p);
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    qWarning() << "Checkpoint file is truncated:" << f_path;
+    return false;
+  }
+  return true;
+}
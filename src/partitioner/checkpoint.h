@@ -0,0 +1,51 @@
+/*!
+  \file checkpoint.h
+  \brief Search checkpoints that allow long-running partitioning to resume.
+  \author Samuel Ng
+  \date 2021-03-20 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_CHECKPOINT_H_
+#define _PT_CHECKPOINT_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  /*! \brief Snapshot of a branch and bound search.
+   *
+   * Contains everything needed to continue a search: the unexplored frontier
+   * (pending stack entries of all workers), the incumbent and the telemetry
+   * counters accumulated so far. The frontier is not tied to the thread count
+   * that produced it so it can be resumed with any number of threads.
+   *
+   * On disk, the checkpoint is stored in a compact binary format where each
+   * frontier entry only stores its depth, cut size and the assigned prefix
+   * packed into bits. Per-net cost caches are rebuilt on resume.
+   */
+  struct Checkpoint
+  {
+    int num_blocks=-1;            //!< Block count of the checkpointed graph.
+    int num_nets=-1;              //!< Net count of the checkpointed graph.
+    QByteArray graph_hash;        //!< sp::Graph::canonicalHash() of the checkpointed graph.
+    int best_cost=-1;             //!< Incumbent cost, -1 if none yet.
+    QVector<int> best_assignment; //!< Incumbent assignment.
+    quint64 visited_leaves=0;     //!< Visited leaf count so far.
+    double pruned_leaves=0;       //!< Pruned leaf count so far.
+    QVector<ProblemNodeParams> frontier;  //!< Unexplored nodes.
+
+    //! Write the checkpoint to the given path. Returns false on failure.
+    bool write(const QString &f_path) const;
+
+    /*! \brief Read a checkpoint from the given path.
+     *
+     * Returns false if the file can't be read or is not a valid checkpoint.
+     */
+    static bool read(const QString &f_path, Checkpoint &ckpt);
+  };
+
+}
+
+#endif
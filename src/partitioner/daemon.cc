@@ -0,0 +1,251 @@
+/*!
+  \file daemon.cc
+  \author Samuel Ng
+  \date 2021-03-24 created
+  \copyright GNU LGPL v3
+  */
+
+#include "daemon.h"
+#include "pjson.h"
+
+using namespace pt;
+
+namespace {
+
+  //! Settings that clients may set, none of them name files to write.
+  const QStringList client_settings = {"threads", "gui_update_batch",
+    "prune_half", "prune_by_cost", "sanity_check", "time_limit", "node_limit",
+    "renumber_nets", "known_lower_bound", "hw_counters"};
+
+}
+
+PartitionDaemon::PartitionDaemon(QObject *parent)
+  : QObject(parent)
+{
+  server_ = new QLocalServer(this);
+  connect(server_, &QLocalServer::newConnection,
+      this, &PartitionDaemon::acceptConnections);
+
+  progress_timer_ = new QTimer(this);
+  progress_timer_->setInterval(500);
+  connect(progress_timer_, &QTimer::timeout, this, &PartitionDaemon::sendProgress);
+
+  // results arrive from the job slots and are queued onto this thread
+  connect(&runner_, &JobRunner::sig_jobFinished, this, &PartitionDaemon::finishJob,
+      Qt::QueuedConnection);
+
+  // cost is counted in blocks and nets
+  graph_cache_.setMaxCost(1 << 24);
+}
+
+PartitionDaemon::~PartitionDaemon()
+{
+  for (DaemonJob &job : jobs_) {
+    job.handle.cancel();
+  }
+}
+
+bool PartitionDaemon::listen(const QString &socket_name)
+{
+  // clean up stale sockets left behind by a daemon that didn't exit cleanly
+  QLocalServer::removeServer(socket_name);
+  if (!server_->listen(socket_name)) {
+    qWarning() << "Unable to listen on" << socket_name << ":"
+      << server_->errorString();
+    return false;
+  }
+  qDebug() << "Partitioning daemon listening on" << server_->fullServerName();
+  progress_timer_->start();
+  return true;
+}
+
+bool PartitionDaemon::setNetlistRoot(const QString &dir)
+{
+  QFileInfo root_info(dir);
+  if (!root_info.isDir()) {
+    qWarning() << "Netlist root" << dir << "isn't a directory";
+    return false;
+  }
+  netlist_root_ = root_info.canonicalFilePath();
+  return true;
+}
+
+void PartitionDaemon::acceptConnections()
+{
+  while (server_->hasPendingConnections()) {
+    QLocalSocket *socket = server_->nextPendingConnection();
+    connect(socket, &QLocalSocket::readyRead, this,
+        [this, socket]() {readRequests(socket);});
+    connect(socket, &QLocalSocket::disconnected, this,
+        [this, socket]() {
+          // nobody is left to receive the results
+          cancelJobs(socket, QJsonValue(QJsonValue::Undefined));
+          socket->deleteLater();
+        });
+  }
+}
+
+void PartitionDaemon::readRequests(QLocalSocket *socket)
+{
+  while (socket->canReadLine()) {
+    QByteArray line = socket->readLine().trimmed();
+    if (line.isEmpty()) {
+      continue;
+    }
+    QJsonParseError parse_error;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &parse_error);
+    if (!doc.isObject()) {
+      writeError(socket, QJsonValue(QJsonValue::Undefined), tr("Invalid request: %1")
+          .arg(parse_error.errorString()));
+      continue;
+    }
+    handleRequest(socket, doc.object());
+  }
+}
+
+void PartitionDaemon::handleRequest(QLocalSocket *socket, const QJsonObject &request)
+{
+  if (request.contains("cancel")) {
+    cancelJobs(socket, request.value("cancel"));
+    return;
+  }
+
+  // take the netlist from the request or from the referenced file
+  QJsonValue request_id = request.value("id");
+  QByteArray netlist;
+  if (request.contains("netlist")) {
+    netlist = request.value("netlist").toString().toUtf8();
+  } else if (request.contains("path")) {
+    if (!readNetlistPath(socket, request_id, request.value("path").toString(),
+          netlist)) {
+      return;
+    }
+  } else {
+    writeError(socket, request_id, "Request has neither netlist nor path.");
+    return;
+  }
+
+  // only take the search options from the client
+  QJsonObject settings_obj = request.value("settings").toObject();
+  for (const QString &name : settings_obj.keys()) {
+    if (!client_settings.contains(name)) {
+      writeError(socket, request_id, tr("Setting %1 isn't accepted by the "
+            "daemon.").arg(name));
+      return;
+    }
+  }
+  PSettings settings = PJson::settingsFromJson(settings_obj);
+
+  // look up the parsed graph by content hash, parse and cache on a miss
+  QByteArray key = QCryptographicHash::hash(netlist, QCryptographicHash::Sha1);
+  sp::GraphPtr *cached_graph = graph_cache_.object(key);
+  bool cache_hit = cached_graph != nullptr;
+  sp::GraphPtr graph;
+  if (cache_hit) {
+    graph = *cached_graph;
+  } else {
+    // renumber before caching so that jobs on the cached graph share it
+    graph = sp::GraphPtr(new sp::Graph(
+          sp::Graph::fromText(netlist).withLocalNetOrder()));
+    if (!graph->isValid()) {
+      writeError(socket, request_id, "Invalid netlist.");
+      return;
+    }
+    // the cache shares the graph with running jobs rather than copying it
+    graph_cache_.insert(key, new sp::GraphPtr(graph),
+        std::max(1, graph->numBlocks() + graph->numNets()));
+  }
+  JobHandle handle = runner_.submit(graph, settings);
+
+  DaemonJob job;
+  job.handle = handle;
+  job.socket = socket;
+  job.request_id = request_id;
+  job.progress = request.value("progress").toBool(false);
+  jobs_.insert(handle.id(), job);
+
+  QJsonObject msg;
+  msg["id"] = request_id;
+  msg["type"] = QString("accepted");
+  msg["cached"] = cache_hit;
+  writeMessage(socket, msg);
+}
+
+bool PartitionDaemon::readNetlistPath(QLocalSocket *socket,
+    const QJsonValue &request_id, const QString &path, QByteArray &netlist)
+{
+  if (netlist_root_.isEmpty()) {
+    writeError(socket, request_id, "Path requests are disabled, send the "
+        "netlist instead.");
+    return false;
+  }
+  // resolve links and .. before checking that the file is under the root
+  QString f_path = QFileInfo(QDir(netlist_root_).filePath(path))
+    .canonicalFilePath();
+  if (f_path.isEmpty() || !f_path.startsWith(netlist_root_ + "/")) {
+    writeError(socket, request_id, tr("Unable to open %1").arg(path));
+    return false;
+  }
+  QFile in_file(f_path);
+  if (!in_file.open(QFile::ReadOnly)) {
+    writeError(socket, request_id, tr("Unable to open %1").arg(path));
+    return false;
+  }
+  netlist = in_file.readAll();
+  return true;
+}
+
+void PartitionDaemon::cancelJobs(QLocalSocket *socket, const QJsonValue &request_id)
+{
+  for (DaemonJob &job : jobs_) {
+    if (job.socket == socket
+        && (request_id.isUndefined() || job.request_id == request_id)) {
+      job.handle.cancel();
+    }
+  }
+}
+
+void PartitionDaemon::sendProgress()
+{
+  for (const DaemonJob &job : jobs_) {
+    if (!job.progress || job.socket.isNull()) {
+      continue;
+    }
+    QJsonObject msg = PJson::progressToJson(job.handle.progress());
+    msg["id"] = job.request_id;
+    msg["type"] = QString("progress");
+    writeMessage(job.socket, msg);
+  }
+}
+
+void PartitionDaemon::finishJob(quint64 job_id, const PResults &results)
+{
+  if (!jobs_.contains(job_id)) {
+    return;
+  }
+  DaemonJob job = jobs_.take(job_id);
+  if (job.socket.isNull()) {
+    return;
+  }
+  QJsonObject msg = PJson::resultsToJson(results);
+  msg["id"] = job.request_id;
+  msg["type"] = QString("result");
+  writeMessage(job.socket, msg);
+}
+
+void PartitionDaemon::writeMessage(QLocalSocket *socket, const QJsonObject &msg)
+{
+  socket->write(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+  socket->write("\n");
+  socket->flush();
+}
+
+void PartitionDaemon::writeError(QLocalSocket *socket, const QJsonValue &request_id,
+    const QString &message)
+{
+  QJsonObject msg;
+  msg["id"] = request_id;
+  msg["type"] = QString("error");
+  msg["message"] = message;
+  writeMessage(socket, msg);
+}
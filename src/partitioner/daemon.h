@@ -0,0 +1,116 @@
+/*!
+  \file daemon.h
+  \brief Long-lived partitioning service listening on a local socket.
+  \author Samuel Ng
+  \date 2021-03-24 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_DAEMON_H_
+#define _PT_DAEMON_H_
+
+#include <QtCore>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "partitioner/jobs.h"
+
+namespace pt {
+
+  /*! \brief Partitioning daemon serving jobs over a local socket.
+   *
+   * Clients send one JSON object per line and receive JSON lines back. A job
+   * request looks like:
+   *
+   *   {"id": 1, "netlist": "2 1\n2 0 1\n", "settings": {"threads": 2},
+   *    "progress": true}
+   *
+   * where "netlist" holds the problem in the input file format and may be
+   * replaced by "path" pointing at a problem file under the netlist root, if
+   * one is set. "settings" uses the PSettings member names, limited to the
+   * search options so that clients can't make the daemon write files. 
+   * Replies are tagged with the request "id" and a
+   * "type" of "accepted", "progress", "result" or "error". A running job can
+   * be cancelled with {"cancel": <id>}.
+   *
+   * Parsed graphs are cached by the hash of their netlist contents so that
+   * repeated jobs skip parsing.
+   */
+  class PartitionDaemon : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    //! Constructor.
+    PartitionDaemon(QObject *parent=nullptr);
+
+    //! Destructor, cancels running jobs.
+    ~PartitionDaemon();
+
+    //! Listen on the specified socket name or path. Returns false on failure.
+    bool listen(const QString &socket_name);
+
+    //! Set the interval between progress messages in ms.
+    void setProgressInterval(int msecs) {progress_timer_->setInterval(msecs);}
+
+    /*! \brief Allow path requests for problem files under the specified directory.
+     *
+     * Relative paths are resolved against the directory. Path requests are
+     * refused while no root is set. Returns false if the directory doesn't
+     * exist.
+     */
+    bool setNetlistRoot(const QString &dir);
+
+  private:
+
+    //! A job dispatched by the daemon.
+    struct DaemonJob
+    {
+      JobHandle handle;               //!< Handle of the running job.
+      QPointer<QLocalSocket> socket;  //!< Client to reply to.
+      QJsonValue request_id;          //!< ID given by the client.
+      bool progress=false;            //!< Whether the client wants progress.
+    };
+
+    //! Accept pending client connections.
+    void acceptConnections();
+
+    //! Read and handle complete request lines from the client.
+    void readRequests(QLocalSocket *socket);
+
+    //! Handle a single parsed request.
+    void handleRequest(QLocalSocket *socket, const QJsonObject &request);
+
+    /*! \brief Read a problem file requested by path, checking it's under the root.
+     *
+     * Returns false and writes an error to the client on failure.
+     */
+    bool readNetlistPath(QLocalSocket *socket, const QJsonValue &request_id,
+        const QString &path, QByteArray &netlist);
+
+    //! Cancel all jobs of the client matching the request ID.
+    void cancelJobs(QLocalSocket *socket, const QJsonValue &request_id);
+
+    //! Send progress of the jobs whose clients asked for it.
+    void sendProgress();
+
+    //! Send results of a finished job.
+    void finishJob(quint64 job_id, const PResults &results);
+
+    //! Write a JSON message as a single line.
+    static void writeMessage(QLocalSocket *socket, const QJsonObject &msg);
+
+    //! Write an error message.
+    static void writeError(QLocalSocket *socket, const QJsonValue &request_id,
+        const QString &message);
+
+    QLocalServer *server_;  //!< Local socket server.
+    QTimer *progress_timer_;  //!< Timer for progress messages.
+    JobRunner runner_;      //!< Runner for dispatched jobs.
+    QCache<QByteArray, sp::GraphPtr> graph_cache_; //!< Parsed graphs by content hash.
+    QString netlist_root_;  //!< Canonical directory for path requests, none if empty.
+    QHash<quint64, DaemonJob> jobs_;  //!< Running jobs by job ID.
+  };
+
+}
+
+#endif
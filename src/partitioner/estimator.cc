@@ -0,0 +1,55 @@
+/*!
+  \file estimator.cc
+  \author Samuel Ng
+  \date 2021-04-01 created
+  \copyright GNU LGPL v3
+  */
+
+#include "estimator.h"
+
+using namespace pt;
+
+WorkEstimator::WorkEstimator(int n_blocks)
+  : n_blocks_(n_blocks)
+{
+  // nothing seen yet, every subtree is complete
+  subtree_nodes_.resize(n_blocks + 1);
+  p_expand_.resize(n_blocks);
+  subtree_nodes_[n_blocks] = 1;
+  for (int depth=n_blocks-1; depth>=0; depth--) {
+    subtree_nodes_[depth] = 1 + 2 * subtree_nodes_[depth+1];
+  }
+}
+
+void WorkEstimator::update(const SearchStats &stats)
+{
+  // probability of expansion by depth, unseen depths take the last seen one
+  double last_seen = 1.;
+  for (int depth=0; depth<n_blocks_; depth++) {
+    double expanded = stats.expanded_by_depth.value(depth);
+    double pruned = 0;
+    for (int reason=0; reason<NumPruneReasons; reason++) {
+      pruned += stats.prunes_by_depth[reason].value(depth);
+    }
+    if (expanded + pruned > 0) {
+      last_seen = expanded / (expanded + pruned);
+    }
+    p_expand_[depth] = last_seen;
+  }
+
+  subtree_nodes_[n_blocks_] = 1;
+  for (int depth=n_blocks_-1; depth>=0; depth--) {
+    // pruned depths end the subtree even if the ones below overflowed
+    subtree_nodes_[depth] = (p_expand_[depth] > 0)
+      ? 1 + 2 * p_expand_[depth] * subtree_nodes_[depth+1] : 1;
+  }
+}
+
+double WorkEstimator::remainingNodes(const QStack<ProblemNodeParams> &stack) const
+{
+  double remaining = 0;
+  for (const ProblemNodeParams &p : stack) {
+    remaining += subtree_nodes_[p.bid];
+  }
+  return remaining;
+}
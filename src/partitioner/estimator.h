@@ -0,0 +1,53 @@
+/*!
+  \file estimator.h
+  \brief Online estimates of the work left in a running search.
+  \author Samuel Ng
+  \date 2021-04-01 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_ESTIMATOR_H_
+#define _PT_ESTIMATOR_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  /*! \brief Estimates the nodes left under a worker's pending stack.
+   *
+   * The search so far is summarized by the probability that a node at each
+   * depth is expanded rather than pruned, taken from the worker's depth
+   * histograms. Treating the tree as a branching process with these
+   * probabilities gives the expected node count of a subtree rooted at each
+   * depth, and the nodes left are the sum over the pending nodes. Depths
+   * that haven't been seen yet borrow the probability of the nearest seen
+   * depth above them, or assume full expansion if there is none.
+   *
+   * Early estimates are rough since cost pruning tightens as the incumbent
+   * improves, but they converge as the search proceeds.
+   */
+  class WorkEstimator
+  {
+  public:
+    //! Construct an estimator for a graph with the given block count.
+    WorkEstimator(int n_blocks);
+
+    //! Rebuild the expected subtree sizes from a worker's statistics.
+    void update(const SearchStats &stats);
+
+    //! Return the expected nodes of a subtree rooted at the given depth.
+    double subtreeNodes(int depth) const {return subtree_nodes_[depth];}
+
+    //! Return the expected nodes left under the pending stack.
+    double remainingNodes(const QStack<ProblemNodeParams> &stack) const;
+
+  private:
+    int n_blocks_;                  //!< Block count, the depth of leaves.
+    QVector<double> subtree_nodes_; //!< Expected subtree node count by depth.
+    QVector<double> p_expand_;      //!< Expansion probability by depth, reused by update().
+  };
+
+}
+
+#endif
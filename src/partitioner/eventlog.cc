@@ -0,0 +1,276 @@
+/*!
+  \file eventlog.cc
+  \author Samuel Ng
+  \date 2021-04-01 created
+  \copyright GNU LGPL v3
+  */
+
+#include "eventlog.h"
+#include <cstring>
+
+using namespace pt;
+
+namespace {
+
+  const char log_magic[8] = "PTEVLOG";
+
+  //! Copy bytes into a ring at the given position, wrapping around its end.
+  void ringWrite(char *ring, quint64 pos, const void *src, int len)
+  {
+    int start = pos & (EventLog::ring_bytes - 1);
+    int first = qMin(len, EventLog::ring_bytes - start);
+    std::memcpy(ring + start, src, first);
+    std::memcpy(ring, static_cast<const char*>(src) + first, len - first);
+  }
+
+  //! Copy bytes out of a ring at the given position, wrapping around its end.
+  void ringRead(const char *ring, quint64 pos, void *dst, int len)
+  {
+    int start = pos & (EventLog::ring_bytes - 1);
+    int first = qMin(len, EventLog::ring_bytes - start);
+    std::memcpy(dst, ring + start, first);
+    std::memcpy(static_cast<char*>(dst) + first, ring, len - first);
+  }
+
+}
+
+EventLog::EventLog(int n_threads, int n_blocks, const QString &f_path,
+    bool text, const QVector<EventLimit> &limits)
+  : n_blocks_(n_blocks), f_path_(f_path), text_(text || f_path.isEmpty()),
+    limits_(limits), start_(std::chrono::steady_clock::now()), stop_(false)
+{
+  for (int tid=0; tid<n_threads; tid++) {
+    Slot *slot = new Slot();
+    slot->ring = new char[ring_bytes];
+    slot->head.store(0);
+    slot->tail.store(0);
+    slots_.append(slot);
+  }
+  writer_ = std::thread(&EventLog::writerLoop, this);
+}
+
+EventLog::~EventLog()
+{
+  close();
+  for (Slot *slot : slots_) {
+    delete[] slot->ring;
+  }
+  qDeleteAll(slots_);
+}
+
+void EventLog::close()
+{
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_.store(true, std::memory_order_release);
+  }
+  wake_.notify_one();
+  writer_.join();
+
+  quint64 written = 0, rate_limited = 0, dropped = 0;
+  for (const Slot *slot : slots_) {
+    written += slot->written;
+    dropped += slot->dropped;
+    for (const EventCounter &counter : slot->counters) {
+      rate_limited += counter.rate_limited;
+    }
+  }
+  qDebug() << QString("Event log: %1 events written, %2 cut by rate limits, "
+      "%3 dropped for full buffers").arg(written).arg(rate_limited).arg(dropped);
+}
+
+QVector<EventLimit> EventLog::defaultLimits()
+{
+  return QVector<EventLimit>(NumSearchEvents);
+}
+
+bool EventLog::parseLimits(const QString &spec, QVector<EventLimit> &limits)
+{
+  limits.resize(NumSearchEvents);
+  for (const QString &pair : spec.split(',')) {
+    if (pair.trimmed().isEmpty()) {
+      continue;
+    }
+    QStringList kv = pair.split('=');
+    QString key = kv[0].trimmed();
+    QStringList vals = (kv.size() == 2) ? kv[1].split(':') : QStringList();
+    int type = 0;
+    while (type < NumSearchEvents && key != eventName((SearchEvent)type)) {
+      type++;
+    }
+    bool ok = type < NumSearchEvents && (vals.size() == 1 || vals.size() == 2);
+    EventLimit limit = limits.value(type);
+    if (ok) {
+      limit.sample_every = vals[0].trimmed().toInt(&ok);
+      ok = ok && limit.sample_every >= 1;
+    }
+    if (ok && vals.size() == 2) {
+      limit.max_per_sec = vals[1].trimmed().toInt(&ok);
+      ok = ok && limit.max_per_sec >= 0;
+    }
+    if (!ok) {
+      qWarning() << "Invalid event log limit" << pair;
+      return false;
+    }
+    limits[type] = limit;
+  }
+  return true;
+}
+
+const char *EventLog::eventName(SearchEvent type)
+{
+  static const char *names[NumSearchEvents] = {"imbalance", "mirror", "cost",
+    "leaf"};
+  return names[type];
+}
+
+bool EventLog::decode(const QString &in_path, QIODevice &out)
+{
+  QFile f(in_path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    qWarning() << "Unable to open event log" << in_path;
+    return false;
+  }
+  QDataStream in(&f);
+  in.setByteOrder(QDataStream::LittleEndian);
+  char magic[8];
+  quint32 version, n_blocks;
+  if (in.readRawData(magic, 8) != 8 || std::memcmp(magic, log_magic, 8) != 0) {
+    qWarning() << "Not a binary event log:" << in_path;
+    return false;
+  }
+  in >> version >> n_blocks;
+  if (version != format_version) {
+    qWarning() << "Unsupported event log version" << version;
+    return false;
+  }
+  while (!in.atEnd()) {
+    quint8 type;
+    quint16 tid;
+    RecordHeader header;
+    in >> type >> tid >> header.ts >> header.bid >> header.cut_size;
+    header.type = type;
+    if (in.status() != QDataStream::Ok || type >= NumSearchEvents
+        || header.bid < 0 || (quint32)header.bid > n_blocks) {
+      qWarning() << "Corrupt event log record in" << in_path;
+      return false;
+    }
+    QByteArray bits((header.bid + 7) / 8, 0);
+    if (in.readRawData(bits.data(), bits.size()) != bits.size()) {
+      qWarning() << "Truncated event log" << in_path;
+      return false;
+    }
+    out.write(formatText(tid, header, bits));
+  }
+  return true;
+}
+
+void EventLog::push(Slot &slot, SearchEvent type, qint64 ts, int bid,
+    int cut_size, const QVector<int> &assignment)
+{
+  int n_bytes = (bid + 7) / 8;
+  int len = sizeof(RecordHeader) + n_bytes;
+  quint64 head = slot.head.load(std::memory_order_relaxed);
+  if (head + len - slot.tail.load(std::memory_order_acquire) > (quint64)ring_bytes) {
+    slot.dropped++;
+    return;
+  }
+  RecordHeader header;
+  header.ts = ts;
+  header.bid = bid;
+  header.cut_size = cut_size;
+  header.type = type;
+  ringWrite(slot.ring, head, &header, sizeof(header));
+  QVarLengthArray<char, 256> bits(n_bytes);
+  std::memset(bits.data(), 0, n_bytes);
+  for (int i=0; i<bid; i++) {
+    bits[i / 8] |= (assignment[i] & 1) << (i % 8);
+  }
+  ringWrite(slot.ring, head + sizeof(header), bits.constData(), n_bytes);
+  slot.head.store(head + len, std::memory_order_release);
+}
+
+void EventLog::writerLoop()
+{
+  QFile out;
+  bool opened = f_path_.isEmpty() ? out.open(stderr, QIODevice::WriteOnly)
+    : out.open(f_path_, QIODevice::WriteOnly | QIODevice::Truncate);
+  if (!opened) {
+    qWarning() << "Unable to open event log" << f_path_;
+  } else if (!text_) {
+    QDataStream ds(&out);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.writeRawData(log_magic, 8);
+    ds << format_version << (quint32)n_blocks_;
+  }
+
+  while (true) {
+    // read the flag first so that a final drain follows the last records
+    bool stopping = stop_.load(std::memory_order_acquire);
+    quint64 n_written = opened ? drain(out) : 0;
+    if (stopping) {
+      break;
+    }
+    if (n_written == 0) {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_.wait_for(lock, std::chrono::milliseconds(5),
+          [this]() {return stop_.load(std::memory_order_acquire);});
+    }
+  }
+  out.close();
+}
+
+quint64 EventLog::drain(QIODevice &out)
+{
+  quint64 n_written = 0;
+  QByteArray buf;
+  for (int tid=0; tid<slots_.size(); tid++) {
+    Slot &slot = *slots_.at(tid);
+    quint64 tail = slot.tail.load(std::memory_order_relaxed);
+    quint64 head = slot.head.load(std::memory_order_acquire);
+    buf.clear();
+    QDataStream ds(&buf, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    while (tail < head) {
+      RecordHeader header;
+      ringRead(slot.ring, tail, &header, sizeof(header));
+      QByteArray bits((header.bid + 7) / 8, 0);
+      ringRead(slot.ring, tail + sizeof(header), bits.data(), bits.size());
+      tail += sizeof(header) + bits.size();
+      if (text_) {
+        buf += formatText(tid, header, bits);
+      } else {
+        ds << header.type << (quint16)tid << header.ts << header.bid
+          << header.cut_size;
+        ds.writeRawData(bits.constData(), bits.size());
+      }
+      slot.written++;
+      n_written++;
+    }
+    slot.tail.store(tail, std::memory_order_release);
+    if (!buf.isEmpty()) {
+      out.write(buf);
+    }
+  }
+  out.flush();
+  return n_written;
+}
+
+QByteArray EventLog::formatText(int tid, const RecordHeader &header,
+    const QByteArray &bits)
+{
+  QByteArray assignment(header.bid, '0');
+  for (int i=0; i<header.bid; i++) {
+    if (bits[i / 8] & (1 << (i % 8))) {
+      assignment[i] = '1';
+    }
+  }
+  return QString("%1 ms thread %2 %3 depth %4 cut %5 assignment %6\n")
+    .arg(header.ts / 1e6, 0, 'f', 6).arg(tid)
+    .arg(eventName((SearchEvent)header.type)).arg(header.bid)
+    .arg(header.cut_size).arg(QString::fromLatin1(assignment)).toUtf8();
+}
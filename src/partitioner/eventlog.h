@@ -0,0 +1,189 @@
+/*!
+  \file eventlog.h
+  \brief Asynchronous buffered logging of search events for verbose runs.
+  \author Samuel Ng
+  \date 2021-04-01 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_EVENTLOG_H_
+#define _PT_EVENTLOG_H_
+
+#include <QtCore>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace pt {
+
+  //! Search events recorded in verbose runs.
+  enum SearchEvent{ImbalancePruneEvent, MirrorPruneEvent, CostPruneEvent,
+    LeafEvent, NumSearchEvents};
+
+  //! Sampling and rate limit of one event type.
+  struct EventLimit
+  {
+    int sample_every=1;       //!< Keep one in this many events.
+    int max_per_sec=10000;    //!< Events kept per second per thread, 0 for no limit.
+  };
+
+  /*! \brief Log of search events written by a background thread.
+   *
+   * Each worker appends fixed header records followed by its assignment
+   * bits to its own single producer, single consumer ring buffer, so
+   * logging takes no locks and doesn't format anything on the worker. A
+   * writer thread drains the rings and writes binary records, or text lines
+   * if asked to. Events are sampled and rate limited per thread and type
+   * before they reach the ring, and events that don't fit in a full ring
+   * are dropped and counted rather than blocking the worker.
+   *
+   * Binary logs start with the magic "PTEVLOG", a version and the block
+   * count, followed by little endian records of the event type (quint8),
+   * thread (quint16), time since the log was opened in ns (qint64), depth
+   * (qint32), cut size (qint32, -1 if not yet calculated) and the assignment
+   * of the first depth blocks packed eight to a byte, low bit first.
+   * decode() turns them into the text form.
+   */
+  class EventLog
+  {
+  public:
+    //! Version of the binary format.
+    static const quint32 format_version = 1;
+
+    //! Ring buffer bytes per thread, a power of two.
+    static const int ring_bytes = 1 << 20;
+
+    /*! \brief Open a log for the given count of threads and start the writer.
+     *
+     * Text is written to stderr if f_path is empty.
+     */
+    EventLog(int n_threads, int n_blocks, const QString &f_path, bool text,
+        const QVector<EventLimit> &limits=defaultLimits());
+
+    //! Destructor, closes the log if still open.
+    ~EventLog();
+
+    //! Record an event of a worker, only called by that worker.
+    void log(int tid, SearchEvent type, int bid, int cut_size,
+        const QVector<int> &assignment)
+    {
+      // const access only, the containers are shared by all workers
+      Slot &slot = *slots_.at(tid);
+      const EventLimit &limit = limits_.at(type);
+      EventCounter &counter = slot.counters[type];
+      if (--counter.countdown > 0) {
+        return;
+      }
+      counter.countdown = limit.sample_every;
+      qint64 now = nowNs();
+      if (limit.max_per_sec > 0) {
+        if (now - counter.window_start >= 1000000000) {
+          counter.window_start = now;
+          counter.window_count = 0;
+        }
+        if (counter.window_count >= limit.max_per_sec) {
+          counter.rate_limited++;
+          return;
+        }
+        counter.window_count++;
+      }
+      push(slot, type, now, bid, cut_size, assignment);
+    }
+
+    /*! \brief Stop the writer once it has drained every ring and close the file.
+     *
+     * Workers must be done logging. The counts of written, rate limited and
+     * dropped events are printed.
+     */
+    void close();
+
+    //! Return the default limits of every event type.
+    static QVector<EventLimit> defaultLimits();
+
+    /*! \brief Parse limits from a comma separated list of type=n[:rate] pairs.
+     *
+     * Types are imbalance, mirror, cost and leaf. n keeps one in n events of
+     * the type and rate caps the kept events per second and thread, 0 for no
+     * cap. Unlisted types keep their defaults. Returns false on unknown types
+     * or invalid values.
+     */
+    static bool parseLimits(const QString &spec, QVector<EventLimit> &limits);
+
+    //! Return the snake case name of an event type.
+    static const char *eventName(SearchEvent type);
+
+    //! Write a binary log as text lines to out, returns false on failure.
+    static bool decode(const QString &in_path, QIODevice &out);
+
+  private:
+    Q_DISABLE_COPY(EventLog)
+
+    //! Sampling and rate limit state of one event type on one thread.
+    struct EventCounter
+    {
+      int countdown=1;          //!< Events until the next sampled one.
+      qint64 window_start=0;    //!< Start of the current rate window in ns.
+      int window_count=0;       //!< Events kept in the current rate window.
+      quint64 rate_limited=0;   //!< Sampled events cut by the rate limit.
+    };
+
+    //! Per-thread ring and counters, the producer and consumer ends are kept apart.
+    struct Slot
+    {
+      char *ring=nullptr;                   //!< Ring buffer of ring_bytes bytes.
+      EventCounter counters[NumSearchEvents]; //!< Producer side counters.
+      quint64 dropped=0;                    //!< Events that didn't fit the ring.
+      std::atomic<quint64> head;            //!< Bytes written by the producer.
+      char pad_[64];                        //!< Keeps head and tail on separate lines.
+      std::atomic<quint64> tail;            //!< Bytes consumed by the writer.
+      quint64 written=0;                    //!< Events written out by the writer.
+    };
+
+    //! Fixed part of a record in the ring.
+    struct RecordHeader
+    {
+      qint64 ts;        //!< Time since the log was opened in ns.
+      qint32 bid;       //!< Depth of the node.
+      qint32 cut_size;  //!< Cut size of the node, -1 if not calculated.
+      quint8 type;      //!< SearchEvent.
+    };
+
+    //! Return the time since the log was opened in ns.
+    qint64 nowNs() const
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_).count();
+    }
+
+    //! Append a record to a thread's ring, dropping it if the ring is full.
+    void push(Slot &slot, SearchEvent type, qint64 ts, int bid, int cut_size,
+        const QVector<int> &assignment);
+
+    //! Writer thread loop.
+    void writerLoop();
+
+    //! Write out the records in every ring, returns the count written.
+    quint64 drain(QIODevice &out);
+
+    //! Format a record as a text line.
+    static QByteArray formatText(int tid, const RecordHeader &header,
+        const QByteArray &bits);
+
+    int n_blocks_;                  //!< Block count of the graph.
+    QString f_path_;                //!< Output path, stderr if empty.
+    bool text_;                     //!< Whether to write text rather than binary.
+    QVector<EventLimit> limits_;    //!< Limits by event type.
+    QVector<Slot*> slots_;          //!< Per-thread slots.
+    std::chrono::steady_clock::time_point start_; //!< Time origin.
+    std::atomic<bool> stop_;        //!< Whether the writer should finish.
+    std::mutex wake_mutex_;         //!< Guards writer wakeups.
+    std::condition_variable wake_;  //!< Wakes the writer to finish.
+    std::thread writer_;            //!< Writer thread.
+    bool closed_=false;             //!< Whether close() has run.
+  };
+
+}
+
+#endif
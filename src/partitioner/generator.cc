@@ -0,0 +1,177 @@
+/*!
+  \file generator.cc
+  \author Samuel Ng
+  \date 2021-03-28 created
+  \copyright GNU LGPL v3
+  */
+
+#include "generator.h"
+#include <cmath>
+#include <limits>
+
+using namespace pt;
+
+
+// GenSettings implementation
+
+bool GenSettings::fromSpec(const QString &spec, GenSettings &settings)
+{
+  for (const QString &pair : spec.split(',')) {
+    if (pair.trimmed().isEmpty()) {
+      continue;
+    }
+    QStringList kv = pair.split('=');
+    QString key = kv[0].trimmed();
+    QString val = (kv.size() == 2) ? kv[1].trimmed() : QString();
+    bool ok = false;
+    if (key == "blocks") {
+      settings.num_blocks = val.toInt(&ok);
+    } else if (key == "nets") {
+      settings.num_nets = val.toInt(&ok);
+    } else if (key == "min_size") {
+      settings.min_net_size = val.toInt(&ok);
+    } else if (key == "max_size") {
+      settings.max_net_size = val.toInt(&ok);
+    } else if (key == "size_exp") {
+      settings.size_exponent = val.toDouble(&ok);
+    } else if (key == "rent") {
+      settings.rent_exponent = val.toDouble(&ok);
+    } else if (key == "clusters") {
+      settings.num_clusters = val.toInt(&ok);
+    } else if (key == "affinity") {
+      settings.cluster_affinity = val.toDouble(&ok);
+    } else if (key == "seed") {
+      settings.seed = val.toULongLong(&ok);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      qWarning() << "Invalid generator setting" << pair;
+      return false;
+    }
+  }
+  return true;
+}
+
+QString GenSettings::toSpec() const
+{
+  return QString("blocks=%1,nets=%2,min_size=%3,max_size=%4,size_exp=%5,"
+      "rent=%6,clusters=%7,affinity=%8,seed=%9")
+    .arg(num_blocks).arg(num_nets).arg(min_net_size).arg(max_net_size)
+    .arg(size_exponent).arg(rent_exponent).arg(num_clusters)
+    .arg(cluster_affinity).arg(seed);
+}
+
+
+// Generator implementation
+
+Generator::Generator(const GenSettings &settings)
+  : settings_(settings), rng_(settings.seed)
+{
+}
+
+bool Generator::isValid() const
+{
+  const GenSettings &s = settings_;
+  return s.num_blocks >= 2 && s.num_nets >= 0 && s.min_net_size >= 2
+    && s.min_net_size <= s.max_net_size && s.max_net_size <= s.num_blocks
+    && s.rent_exponent > 0 && s.num_clusters >= 1
+    && s.num_clusters <= s.num_blocks / s.max_net_size
+    && s.cluster_affinity >= 0 && s.cluster_affinity <= 1;
+}
+
+sp::Graph Generator::generate()
+{
+  if (!isValid()) {
+    qWarning() << "Invalid generator settings" << settings_.toSpec();
+    return sp::Graph();
+  }
+  const GenSettings &s = settings_;
+  rng_.seed(s.seed);
+
+  // net size distribution
+  QVector<double> size_cdf;
+  double total = 0;
+  for (int k=s.min_net_size; k<=s.max_net_size; k++) {
+    total += std::pow(k, -s.size_exponent);
+    size_cdf.append(total);
+  }
+
+  // window levels, the top level spans all blocks
+  int n_levels = 0;
+  while ((qint64(1) << n_levels) < s.num_blocks) {
+    n_levels++;
+  }
+  bool local = s.rent_exponent < 1;
+  int cluster_size = s.num_blocks / s.num_clusters;
+
+  QVector<QVector<int>> nets(s.num_nets);
+  for (int nid=0; nid<s.num_nets; nid++) {
+    int driver = nid % s.num_blocks;
+    int size = s.min_net_size + sampleCdf(size_cdf);
+
+    // pick the range of block IDs the net is drawn from
+    int lo = 0, hi = s.num_blocks;
+    if (s.num_clusters > 1 && uniformReal() < s.cluster_affinity) {
+      int cluster = qMin(driver / cluster_size, s.num_clusters - 1);
+      lo = cluster * cluster_size;
+      hi = (cluster == s.num_clusters - 1) ? s.num_blocks : lo + cluster_size;
+    } else if (local) {
+      int min_level = 0;
+      while ((1 << min_level) < size) {
+        min_level++;
+      }
+      QVector<double> level_cdf;
+      total = 0;
+      for (int l=min_level; l<=n_levels; l++) {
+        total += std::pow(2., l * (s.rent_exponent - 1));
+        level_cdf.append(total);
+      }
+      int level = min_level + sampleCdf(level_cdf);
+      if (level < n_levels) {
+        int width = 1 << level;
+        lo = driver / width * width;
+        hi = qMin(lo + width, s.num_blocks);
+        lo = qMax(0, hi - width);   // keep the last window full width
+      }
+    }
+
+    // draw the remaining pins without repetition
+    QVector<int> &net = nets[nid];
+    net.append(driver);
+    while (net.size() < size) {
+      int bid = lo + int(uniform(hi - lo));
+      if (!net.contains(bid)) {
+        net.append(bid);
+      }
+    }
+  }
+  return sp::Graph::fromNets(s.num_blocks, nets);
+}
+
+quint64 Generator::uniform(quint64 n)
+{
+  // reject the incomplete top range so that all residues are equally likely
+  quint64 limit = std::numeric_limits<quint64>::max()
+    - std::numeric_limits<quint64>::max() % n;
+  quint64 r;
+  do {
+    r = rng_();
+  } while (r >= limit);
+  return r % n;
+}
+
+double Generator::uniformReal()
+{
+  return std::ldexp(double(rng_() >> 11), -53);
+}
+
+int Generator::sampleCdf(const QVector<double> &cdf)
+{
+  double r = uniformReal() * cdf.last();
+  int i = 0;
+  while (i < cdf.size() - 1 && cdf[i] <= r) {
+    i++;
+  }
+  return i;
+}
@@ -0,0 +1,90 @@
+/*!
+  \file generator.h
+  \brief Deterministic synthetic netlists for scaling studies.
+  \author Samuel Ng
+  \date 2021-03-28 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_GENERATOR_H_
+#define _PT_GENERATOR_H_
+
+#include <QtCore>
+#include <random>
+#include "spatial.h"
+
+namespace pt {
+
+  //! Parameters of a synthetic netlist.
+  struct GenSettings
+  {
+    int num_blocks=64;          //!< Block count.
+    int num_nets=96;            //!< Net count.
+    int min_net_size=2;         //!< Smallest net size.
+    int max_net_size=6;         //!< Largest net size.
+    double size_exponent=2.5;   //!< Net sizes k are drawn with weight k^-size_exponent.
+    double rent_exponent=1.0;   //!< Locality, 1 for none, smaller is more local.
+    int num_clusters=1;         //!< Count of contiguous block clusters.
+    double cluster_affinity=0;  //!< Chance that a net stays inside its cluster.
+    quint64 seed=1;             //!< Random seed.
+
+    /*! \brief Parse settings from a comma separated list of key=value pairs.
+     *
+     * Keys are blocks, nets, min_size, max_size, size_exp, rent, clusters,
+     * affinity and seed, unlisted keys keep their defaults. Returns false on
+     * unknown keys or invalid values.
+     */
+    static bool fromSpec(const QString &spec, GenSettings &settings);
+
+    //! Return the settings as a spec accepted by fromSpec().
+    QString toSpec() const;
+  };
+
+  /*! \brief Generates synthetic netlists.
+   *
+   * Net i is driven by block i modulo the block count so that every block is
+   * connected once there are at least as many nets as blocks, the remaining
+   * pins are then drawn without repetition.
+   *
+   * With clusters, blocks are split into contiguous ID ranges and each net
+   * stays inside its driver's cluster with probability cluster_affinity.
+   * Otherwise Rent-style locality applies: the net is confined to the
+   * aligned window of 2^l consecutive block IDs around its driver, where
+   * level l is drawn with weight 2^(l (rent_exponent - 1)) from the levels
+   * whose windows fit the net. Smaller exponents favour short nets and an
+   * exponent of 1 or more draws pins from all blocks uniformly.
+   *
+   * Only the raw output of std::mt19937_64, which the standard fully
+   * specifies, is used and all sampling is done here, so the same settings
+   * give the same netlist on every platform and standard library.
+   */
+  class Generator
+  {
+  public:
+    //! Construct a generator with the given settings.
+    Generator(const GenSettings &settings);
+
+    //! Return whether the settings describe a possible netlist.
+    bool isValid() const;
+
+    //! Generate the netlist, invalid if the settings are.
+    sp::Graph generate();
+
+  private:
+
+    //! Return a uniformly random integer in [0, n).
+    quint64 uniform(quint64 n);
+
+    //! Return a uniformly random double in [0, 1).
+    double uniformReal();
+
+    //! Return a sample of the discrete distribution with the given CDF.
+    int sampleCdf(const QVector<double> &cdf);
+
+    GenSettings settings_;  //!< Generator settings.
+    std::mt19937_64 rng_;   //!< Random engine.
+  };
+
+}
+
+#endif
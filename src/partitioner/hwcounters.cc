@@ -0,0 +1,150 @@
+/*!
+  \file hwcounters.cc
+  \author Samuel Ng
+  \date 2021-03-30 created
+  \copyright GNU LGPL v3
+  */
+
+#include "hwcounters.h"
+
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace pt;
+
+
+// HwCounters implementation
+
+bool HwCounters::isValid() const
+{
+  for (int ev=0; ev<NumEvents; ev++) {
+    if (available((Event)ev)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double HwCounters::ipc() const
+{
+  if (!available(Cycles) || !available(Instructions) || values[Cycles] == 0) {
+    return -1;
+  }
+  return double(values[Instructions]) / values[Cycles];
+}
+
+double HwCounters::perNode(Event ev, quint64 nodes) const
+{
+  if (!available(ev) || nodes == 0) {
+    return -1;
+  }
+  return double(values[ev]) / nodes;
+}
+
+void HwCounters::merge(const HwCounters &other)
+{
+  for (int ev=0; ev<NumEvents; ev++) {
+    if (available((Event)ev) && other.available((Event)ev)) {
+      values[ev] += other.values[ev];
+    } else {
+      values[ev] = -1;
+    }
+  }
+}
+
+const char *HwCounters::eventName(Event ev)
+{
+  static const char *names[NumEvents] = {"cycles", "instructions",
+    "cache_misses", "branch_misses", "stalled_cycles_frontend",
+    "stalled_cycles_backend"};
+  return names[ev];
+}
+
+
+// PerfCounters implementation
+
+PerfCounters::PerfCounters()
+{
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    fds_[ev] = -1;
+  }
+#ifdef Q_OS_LINUX
+  static const quint64 configs[HwCounters::NumEvents] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+  // events are opened separately rather than as a group so that one
+  // unsupported event doesn't take the others down with it
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[ev];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds_[ev] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef Q_OS_LINUX
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    if (fds_[ev] >= 0) {
+      close(fds_[ev]);
+    }
+  }
+#endif
+}
+
+bool PerfCounters::isOpen() const
+{
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    if (fds_[ev] >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::start()
+{
+#ifdef Q_OS_LINUX
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    if (fds_[ev] >= 0) {
+      ioctl(fds_[ev], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[ev], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+HwCounters PerfCounters::stop()
+{
+  HwCounters counters;
+#ifdef Q_OS_LINUX
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    if (fds_[ev] < 0) {
+      continue;
+    }
+    ioctl(fds_[ev], PERF_EVENT_IOC_DISABLE, 0);
+    // value, time enabled and time running
+    quint64 buf[3];
+    if (read(fds_[ev], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+      continue;
+    }
+    double scale = (buf[2] < buf[1]) ? double(buf[1]) / buf[2] : 1.;
+    counters.values[ev] = qint64(buf[0] * scale);
+  }
+#endif
+  return counters;
+}
@@ -0,0 +1,80 @@
+/*!
+  \file hwcounters.h
+  \brief Per-thread hardware performance counters through perf_event_open.
+  \author Samuel Ng
+  \date 2021-03-30 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_HWCOUNTERS_H_
+#define _PT_HWCOUNTERS_H_
+
+#include <QtCore>
+
+namespace pt {
+
+  //! Hardware counter values of one thread or a sum over threads.
+  struct HwCounters
+  {
+    //! Counted hardware events.
+    enum Event{Cycles, Instructions, CacheMisses, BranchMisses,
+      StalledCyclesFrontend, StalledCyclesBackend, NumEvents};
+
+    //! Counter values, -1 for events that couldn't be counted.
+    qint64 values[NumEvents] = {-1, -1, -1, -1, -1, -1};
+
+    //! Return whether the event was counted.
+    bool available(Event ev) const {return values[ev] >= 0;}
+
+    //! Return whether any event was counted.
+    bool isValid() const;
+
+    //! Return instructions per cycle, -1 if either wasn't counted.
+    double ipc() const;
+
+    //! Return the event count per node, -1 if not counted or no nodes.
+    double perNode(Event ev, quint64 nodes) const;
+
+    //! Add the counts of another thread, events missing from either are dropped.
+    void merge(const HwCounters &other);
+
+    //! Return the snake case name of an event.
+    static const char *eventName(Event ev);
+  };
+
+  /*! \brief Counts hardware events of the calling thread.
+   *
+   * Counters are opened for the thread that constructs the object and only
+   * count while that thread runs in user space. Events that the kernel or
+   * hardware refuses, for instance under a restrictive
+   * perf_event_paranoid, are left out and the rest are still counted. On
+   * platforms other than Linux nothing is counted. Values are scaled up when
+   * the kernel multiplexes more events than there are hardware counters.
+   */
+  class PerfCounters
+  {
+  public:
+    //! Open the counters for the calling thread, disabled.
+    PerfCounters();
+
+    //! Close the counters.
+    ~PerfCounters();
+
+    //! Return whether any counter could be opened.
+    bool isOpen() const;
+
+    //! Reset and start counting.
+    void start();
+
+    //! Stop counting and return the counts since start().
+    HwCounters stop();
+
+  private:
+    Q_DISABLE_COPY(PerfCounters)
+
+    int fds_[HwCounters::NumEvents];  //!< Counter file descriptors, -1 if not open.
+  };
+
+}
+
+#endif
@@ -0,0 +1,314 @@
+/*!
+  \file incremental.cc
+  \author Samuel Ng
+  \date 2021-03-28 created
+  \copyright GNU LGPL v3
+  */
+
+#include "incremental.h"
+#include <algorithm>
+
+using namespace pt;
+
+namespace {
+
+  //! Return the cut change if the block switched partitions.
+  int flipDelta(const sp::Graph &graph, const QVector<int> &assignment, int bid)
+  {
+    int delta = 0;
+    for (int nid : graph.blockNets(bid)) {
+      delta += sp::Chip::netCost(nid, graph, assignment, bid, 1-assignment[bid])
+        - sp::Chip::netCost(nid, graph, assignment);
+    }
+    return delta;
+  }
+
+  //! Parse a net in the input file format from the given fields.
+  bool parseNet(const QStringList &fields, int first, QVector<int> &net)
+  {
+    bool ok = fields.size() > first;
+    int count = ok ? fields[first].toInt(&ok) : 0;
+    if (!ok || count != fields.size() - first - 1) {
+      return false;
+    }
+    net.clear();
+    for (int i=first+1; i<fields.size() && ok; i++) {
+      net.append(fields[i].toInt(&ok));
+      ok = ok && net.last() >= 0;
+    }
+    return ok;
+  }
+
+}
+
+
+// NetlistDiff implementation
+
+bool NetlistDiff::read(const QString &f_path, NetlistDiff &diff)
+{
+  QFile f(f_path);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    qWarning() << "Unable to open netlist diff" << f_path;
+    return false;
+  }
+  diff = NetlistDiff();
+  int line_num = 0;
+  while (!f.atEnd()) {
+    line_num++;
+    QString line = QString::fromUtf8(f.readLine()).simplified();
+    if (line.isEmpty() || line.startsWith('#')) {
+      continue;
+    }
+    QStringList fields = line.split(' ');
+    QVector<int> net;
+    bool ok = true;
+    if (fields[0] == "+" && parseNet(fields, 1, net)) {
+      diff.added_nets.append(net);
+    } else if (fields[0] == "-" && parseNet(fields, 1, net)) {
+      diff.removed_nets.append(net);
+    } else if (fields[0] == "blocks" && fields.size() == 2) {
+      diff.num_blocks = fields[1].toInt(&ok);
+      ok = ok && diff.num_blocks >= 0;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      qWarning() << QString("Line %1: invalid netlist diff entry.").arg(line_num);
+      return false;
+    }
+  }
+  return true;
+}
+
+sp::Graph NetlistDiff::apply(const sp::Graph &graph, int *removed_count) const
+{
+  int n_blocks = (num_blocks >= 0) ? num_blocks : graph.numBlocks();
+
+  // index the existing nets by their sorted block sets
+  QVector<QVector<int>> nets;
+  QHash<QVector<int>, QList<int>> net_ids;
+  for (int nid=0; nid<graph.numNets(); nid++) {
+    QVector<int> net = graph.net(nid).toVector();
+    nets.append(net);
+    std::sort(net.begin(), net.end());
+    net_ids[net].append(nid);
+  }
+
+  // remove nets matching the removed block sets
+  QVector<bool> removed(nets.size(), false);
+  int n_removed = 0;
+  for (QVector<int> net : removed_nets) {
+    std::sort(net.begin(), net.end());
+    QList<int> &candidates = net_ids[net];
+    if (candidates.isEmpty()) {
+      qWarning() << "Net to remove not found in the netlist:" << net;
+      continue;
+    }
+    removed[candidates.takeFirst()] = true;
+    n_removed++;
+  }
+
+  // assemble the edited nets, dropping connections to removed blocks
+  QVector<QVector<int>> new_nets;
+  for (int nid=0; nid<nets.size(); nid++) {
+    if (removed[nid]) {
+      continue;
+    }
+    QVector<int> net;
+    for (int bid : nets[nid]) {
+      if (bid < n_blocks) {
+        net.append(bid);
+      }
+    }
+    new_nets.append(net);
+  }
+  new_nets += added_nets;
+
+  if (removed_count != nullptr) {
+    *removed_count = n_removed;
+  }
+  return sp::Graph::fromNets(n_blocks, new_nets);
+}
+
+QVector<int> NetlistDiff::touchedBlocks(const sp::Graph &old_graph) const
+{
+  int n_blocks = (num_blocks >= 0) ? num_blocks : old_graph.numBlocks();
+  QVector<bool> touched(n_blocks, false);
+  for (const QVector<QVector<int>> *nets : {&added_nets, &removed_nets}) {
+    for (const QVector<int> &net : *nets) {
+      for (int bid : net) {
+        if (bid < n_blocks) {
+          touched[bid] = true;
+        }
+      }
+    }
+  }
+  for (int bid=old_graph.numBlocks(); bid<n_blocks; bid++) {
+    touched[bid] = true;
+  }
+  QVector<int> bids;
+  for (int bid=0; bid<n_blocks; bid++) {
+    if (touched[bid]) {
+      bids.append(bid);
+    }
+  }
+  return bids;
+}
+
+
+// PreviousSolution implementation
+
+bool PreviousSolution::readJson(const QString &f_path, PreviousSolution &prev)
+{
+  QFile f(f_path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    qWarning() << "Unable to open previous solution" << f_path;
+    return false;
+  }
+  QJsonObject obj = QJsonDocument::fromJson(f.readAll()).object();
+  if (obj.contains("results")) {
+    obj = obj.value("results").toObject();
+  }
+  prev = PreviousSolution();
+  prev.cut_size = obj.value("best_cut_size").toInt(-1);
+  prev.proven_optimal = obj.value("proven_optimal").toBool(false);
+  for (const QJsonValue &part : obj.value("assignment").toArray()) {
+    prev.assignment.append(part.toInt(-1));
+  }
+  if (prev.cut_size < 0 || prev.assignment.isEmpty()) {
+    qWarning() << "No solution found in" << f_path;
+    return false;
+  }
+  return true;
+}
+
+
+// Incremental implementation
+
+QVector<int> Incremental::repairAssignment(const sp::Graph &graph,
+    const QVector<int> &old_assignment, const QVector<int> &touched)
+{
+  int n_blocks = graph.numBlocks();
+  int max_in_part = (n_blocks + 1) / 2;
+  QVector<int> assignment = old_assignment;
+  assignment.resize(n_blocks);
+  int counts[2] = {0, 0};
+  for (int bid=0; bid<n_blocks; bid++) {
+    if (bid >= old_assignment.size()
+        || (assignment[bid] != 0 && assignment[bid] != 1)) {
+      assignment[bid] = -1;
+    } else {
+      counts[assignment[bid]]++;
+    }
+  }
+
+  // place unassigned blocks on the cheaper side that has room
+  for (int bid=0; bid<n_blocks; bid++) {
+    if (assignment[bid] != -1) {
+      continue;
+    }
+    int cost[2];
+    for (int part : {0, 1}) {
+      cost[part] = 0;
+      for (int nid : graph.blockNets(bid)) {
+        cost[part] += sp::Chip::netCost(nid, graph, assignment, bid, part);
+      }
+    }
+    int part = (cost[1] < cost[0]) ? 1 : 0;
+    if (counts[part] >= max_in_part || (cost[0] == cost[1] && counts[1] < counts[0])) {
+      part = 1 - part;
+    }
+    assignment[bid] = part;
+    counts[part]++;
+  }
+
+  // rebalance by moving the cheapest blocks off the larger side
+  for (int big = (counts[0] > counts[1]) ? 0 : 1; counts[big] > max_in_part; ) {
+    int best_bid = -1, best_delta = 0;
+    for (int bid=0; bid<n_blocks; bid++) {
+      if (assignment[bid] != big) {
+        continue;
+      }
+      int delta = flipDelta(graph, assignment, bid);
+      if (best_bid < 0 || delta < best_delta) {
+        best_bid = bid;
+        best_delta = delta;
+      }
+    }
+    assignment[best_bid] = 1 - big;
+    counts[big]--;
+    counts[1-big]++;
+  }
+
+  // improve around the edit with moves and swaps that reduce the cut
+  QVector<bool> is_candidate(n_blocks, false);
+  QVector<int> candidates;
+  for (int bid : touched) {
+    for (int nid : graph.blockNets(bid)) {
+      for (int nbid : graph.net(nid)) {
+        if (!is_candidate[nbid]) {
+          is_candidate[nbid] = true;
+          candidates.append(nbid);
+        }
+      }
+    }
+  }
+  bool improved = true;
+  for (int pass=0; pass<4 && improved; pass++) {
+    improved = false;
+    for (int bid : candidates) {
+      int part = assignment[bid];
+      int delta = flipDelta(graph, assignment, bid);
+      if (delta < 0 && counts[1-part] < max_in_part) {
+        assignment[bid] = 1 - part;
+        counts[part]--;
+        counts[1-part]++;
+        improved = true;
+        continue;
+      }
+
+      // swap with a connected block on the other side
+      assignment[bid] = 1 - part;
+      int best_nbid = -1, best_delta = 0;
+      for (int nid : graph.blockNets(bid)) {
+        for (int nbid : graph.net(nid)) {
+          if (nbid == bid || assignment[nbid] != 1 - part) {
+            continue;
+          }
+          int swap_delta = delta + flipDelta(graph, assignment, nbid);
+          if (swap_delta < best_delta) {
+            best_nbid = nbid;
+            best_delta = swap_delta;
+          }
+        }
+      }
+      if (best_nbid >= 0) {
+        assignment[best_nbid] = part;
+        improved = true;
+      } else {
+        assignment[bid] = part;
+      }
+    }
+  }
+  return assignment;
+}
+
+PSettings Incremental::warmStart(const sp::Graph &old_graph,
+    const sp::Graph &new_graph, const NetlistDiff &diff, int removed_count,
+    const PreviousSolution &prev, PSettings settings)
+{
+  settings.incumbent = repairAssignment(new_graph, prev.assignment,
+      diff.touchedBlocks(old_graph));
+
+  // bounds only carry over when the block set is unchanged
+  if (prev.proven_optimal && prev.assignment.size() == old_graph.numBlocks()
+      && new_graph.numBlocks() == old_graph.numBlocks()) {
+    settings.known_lower_bound = std::max(0, prev.cut_size - removed_count);
+  }
+  if (settings.verbose) {
+    qDebug() << "Warm start incumbent cut:"
+      << sp::Chip::calcCost(new_graph, settings.incumbent)
+      << "known lower bound:" << settings.known_lower_bound;
+  }
+  return settings;
+}
@@ -0,0 +1,94 @@
+/*!
+  \file incremental.h
+  \brief Warm-started re-solves after small netlist edits.
+  \author Samuel Ng
+  \date 2021-03-28 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_INCREMENTAL_H_
+#define _PT_INCREMENTAL_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  /*! \brief Edits to a netlist.
+   *
+   * Diff files hold one edit per line:
+   *
+   *   + 3 0 4 7    add a net connecting blocks 0, 4 and 7
+   *   - 2 1 2      remove a net connecting blocks 1 and 2
+   *   blocks 12    change the block count to 12
+   *
+   * Nets are given in the input file format and removed nets are matched by
+   * their set of blocks. Added blocks take the next free IDs, removing blocks
+   * drops the highest IDs along with their connections. Blank lines and lines
+   * starting with '#' are ignored.
+   */
+  struct NetlistDiff
+  {
+    int num_blocks=-1;                //!< New block count, -1 if unchanged.
+    QVector<QVector<int>> added_nets;   //!< Nets to add.
+    QVector<QVector<int>> removed_nets; //!< Nets to remove.
+
+    //! Read a diff file, returns false on error.
+    static bool read(const QString &f_path, NetlistDiff &diff);
+
+    /*! \brief Apply the diff to a graph.
+     *
+     * The count of nets actually removed is written to removed_count if
+     * provided. Returns an invalid graph if an added net is out of range.
+     */
+    sp::Graph apply(const sp::Graph &graph, int *removed_count=nullptr) const;
+
+    //! Return the blocks touched by the diff on the edited graph.
+    QVector<int> touchedBlocks(const sp::Graph &old_graph) const;
+  };
+
+  //! A previous solution to warm start from.
+  struct PreviousSolution
+  {
+    QVector<int> assignment;    //!< Block assignment.
+    int cut_size=-1;            //!< Cut size of the assignment.
+    bool proven_optimal=false;  //!< Whether the cut was proven optimal.
+
+    /*! \brief Read a solution from JSON.
+     *
+     * Accepts the run report written by --output json as well as a bare
+     * results object.
+     */
+    static bool readJson(const QString &f_path, PreviousSolution &prev);
+  };
+
+  //! Warm starts for re-solving an edited netlist.
+  class Incremental
+  {
+  public:
+    /*! \brief Repair an assignment for an edited graph.
+     *
+     * Blocks keep their previous partitions where possible. New blocks are
+     * placed greedily, the partitions are rebalanced, and then moves and
+     * swaps around the touched blocks are applied while they reduce the cut.
+     * The work done is proportional to the size of the edit.
+     */
+    static QVector<int> repairAssignment(const sp::Graph &graph,
+        const QVector<int> &old_assignment, const QVector<int> &touched);
+
+    /*! \brief Return settings warm-started from the previous solution.
+     *
+     * The repaired assignment becomes the incumbent. If the previous cut was
+     * proven optimal and the block set is unchanged, removing k nets can
+     * lower the optimum by at most k while adding nets can't lower it, so
+     * the old cut minus k is passed on as a known lower bound and the search
+     * stops as soon as it is met.
+     */
+    static PSettings warmStart(const sp::Graph &old_graph,
+        const sp::Graph &new_graph, const NetlistDiff &diff, int removed_count,
+        const PreviousSolution &prev, PSettings settings);
+  };
+
+}
+
+#endif
@@ -0,0 +1,219 @@
+/*!
+  \file jobs.cc
+  \author Samuel Ng
+  \date 2021-03-22 created
+  \copyright GNU LGPL v3
+  */
+
+#include "jobs.h"
+#include "resultcache.h"
+
+using namespace pt;
+
+Q_GLOBAL_STATIC(JobRunner, global_runner)
+
+namespace pt {
+
+  //! State of a job shared between its handles and the runner.
+  struct JobState
+  {
+    //! Construct the state for a job that is about to be queued.
+    JobState(quint64 id, sp::GraphPtr graph, const PSettings &settings)
+      : id(id), graph(graph), settings(settings), future(promise.get_future()) {};
+
+    quint64 id;                   //!< Job ID.
+    sp::GraphPtr graph;           //!< Graph to be partitioned.
+    PSettings settings;           //!< Partitioner settings.
+
+    std::mutex mutex;             //!< Guards the members below.
+    PProgress::State state=PProgress::Queued;  //!< Job state.
+    bool cancel_requested=false;  //!< Whether the job has been cancelled.
+    Partitioner *partitioner=nullptr; //!< Partitioner while the job is running.
+    PProgress final_progress;     //!< Progress snapshot taken at completion.
+
+    std::promise<PResults> promise;       //!< Promise fulfilled by the runner.
+    std::shared_future<PResults> future;  //!< Future shared by all handles.
+  };
+
+}
+
+namespace {
+
+  //! Runnable that runs a single job in one of the runner's job slots.
+  class JobRunnable : public QRunnable
+  {
+  public:
+    //! Construct with the job state and the runner to signal.
+    JobRunnable(const std::shared_ptr<JobState> &state, JobRunner *runner)
+      : state_(state), runner_(runner) {};
+
+    //! Run the partitioner, blocking until it completes.
+    void run() override
+    {
+      // an unreadable netlist has nothing to partition, finish with the 
+      // default (empty) results rather than running on a broken graph
+      if (state_->graph.isNull() || !state_->graph->isValid()) {
+        qWarning() << "Job" << state_->id << "has an invalid graph, skipping.";
+        finish(PResults(), PProgress());
+        return;
+      }
+
+      QElapsedTimer timer;
+      timer.start();
+
+      // return proven results straight from the cache, otherwise use the 
+      // cached bound as the starting incumbent
+      QScopedPointer<ResultCache> cache;
+      QByteArray graph_key;
+      PSettings settings = state_->settings;
+      if (!settings.cache_dir.isEmpty()) {
+        cache.reset(new ResultCache(settings.cache_dir));
+        graph_key = state_->graph->canonicalHash();
+        ResultCache::Entry entry;
+        if (cache->lookup(graph_key, state_->graph, entry)) {
+          if (entry.proven_optimal) {
+            PResults results;
+            results.best_cut_size = entry.cut_size;
+            results.best_assignment = entry.assignment;
+            results.proven_optimal = true;
+            results.lower_bound = entry.cut_size;
+            results.gap = 0;
+            results.cached = true;
+            results.wall_time = timer.elapsed();
+            finish(results, PProgress());
+            return;
+          }
+          if (settings.incumbent.isEmpty()) {
+            settings.incumbent = entry.assignment;
+          }
+        }
+      }
+
+      Partitioner partitioner(state_->graph, settings);
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->cancel_requested) {
+          partitioner.cancel();
+        }
+        state_->partitioner = &partitioner;
+        state_->state = PProgress::Running;
+      }
+
+      partitioner.runPartitioner();
+      PResults results = partitioner.results();
+      if (!cache.isNull()) {
+        cache->store(graph_key, state_->graph, results);
+      }
+      finish(results, partitioner.progress());
+    }
+
+  private:
+
+    //! Publish the results of the job.
+    void finish(const PResults &results, const PProgress &progress)
+    {
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->final_progress = progress;
+        state_->final_progress.state = PProgress::Finished;
+        state_->partitioner = nullptr;
+        state_->state = PProgress::Finished;
+      }
+      state_->promise.set_value(results);
+      emit runner_->sig_jobFinished(state_->id, results);
+    }
+
+    std::shared_ptr<JobState> state_; //!< Job state.
+    JobRunner *runner_;               //!< Runner that owns the job slot.
+  };
+
+}
+
+
+// JobHandle implementation
+
+quint64 JobHandle::id() const
+{
+  return state_->id;
+}
+
+bool JobHandle::isFinished() const
+{
+  return waitFor(0);
+}
+
+bool JobHandle::waitFor(int msecs) const
+{
+  return state_->future.wait_for(std::chrono::milliseconds(msecs))
+    == std::future_status::ready;
+}
+
+PResults JobHandle::result() const
+{
+  return state_->future.get();
+}
+
+PProgress JobHandle::progress() const
+{
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  if (state_->state == PProgress::Finished) {
+    return state_->final_progress;
+  }
+  PProgress prog;
+  if (state_->partitioner != nullptr) {
+    prog = state_->partitioner->progress();
+  }
+  prog.state = state_->state;
+  return prog;
+}
+
+void JobHandle::cancel()
+{
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->cancel_requested = true;
+  if (state_->partitioner != nullptr) {
+    state_->partitioner->cancel();
+  }
+}
+
+
+// JobRunner implementation
+
+JobRunner::JobRunner(int max_jobs, QObject *parent)
+  : QObject(parent), next_id_(0)
+{
+  qRegisterMetaType<pt::PResults>("pt::PResults");
+  if (max_jobs > 0) {
+    pool_.setMaxThreadCount(max_jobs);
+  }
+}
+
+JobRunner::~JobRunner()
+{
+  pool_.waitForDone();
+}
+
+JobHandle JobRunner::submit(const sp::Graph &graph, const PSettings &settings)
+{
+  return submit(sp::GraphPtr(new sp::Graph(graph)), settings);
+}
+
+JobHandle JobRunner::submit(sp::GraphPtr graph, PSettings settings)
+{
+  // renumber once per graph here rather than in every partitioner, graphs 
+  // frozen by the daemon cache or the GUI already come in local order
+  if (settings.renumber_nets && !graph->hasLocalNetOrder() && graph->isValid()) {
+    graph = sp::GraphPtr(new sp::Graph(graph->withLocalNetOrder()));
+  }
+  settings.headless = true;
+  settings.no_dtv = true;
+  std::shared_ptr<JobState> state = std::make_shared<JobState>(
+      next_id_.fetch_add(1), graph, settings);
+  pool_.start(new JobRunnable(state, this));
+  return JobHandle(state);
+}
+
+JobRunner *JobRunner::global()
+{
+  return global_runner();
+}
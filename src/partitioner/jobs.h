@@ -0,0 +1,126 @@
+/*!
+  \file jobs.h
+  \brief Asynchronous partitioning jobs with futures and cancellation.
+  \author Samuel Ng
+  \date 2021-03-22 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_JOBS_H_
+#define _PT_JOBS_H_
+
+#include <QtCore>
+#include <future>
+#include <memory>
+#include <mutex>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  // forward declarations
+  struct JobState;
+  class JobRunner;
+
+  /*! \brief Handle to a submitted partitioning job.
+   *
+   * Handles are cheap to copy and all copies refer to the same job. None of
+   * the methods require a Qt event loop.
+   */
+  class JobHandle
+  {
+  public:
+    //! Construct an invalid handle.
+    JobHandle() {};
+
+    //! Return whether this handle refers to a job.
+    bool isValid() const {return state_ != nullptr;}
+
+    //! Return the ID of the job, unique within its JobRunner.
+    quint64 id() const;
+
+    //! Return whether the results are available.
+    bool isFinished() const;
+
+    //! Wait for up to msecs for the results, returns whether they are available.
+    bool waitFor(int msecs) const;
+
+    //! Block until the results are available and return them.
+    PResults result() const;
+
+    //! Return a snapshot of the job progress.
+    PProgress progress() const;
+
+    /*! \brief Cancel the job.
+     *
+     * A queued job finishes immediately once it is dequeued, a running job
+     * stops cooperatively. Either way the results report the best cut found
+     * and a lower bound.
+     */
+    void cancel();
+
+  private:
+
+    friend class JobRunner;
+
+    //! Construct a handle for the given job state.
+    JobHandle(const std::shared_ptr<JobState> &state) : state_(state) {};
+
+    std::shared_ptr<JobState> state_; //!< State shared with the runner.
+  };
+
+  /*! \brief Runs partitioning jobs on a pool of job slots.
+   *
+   * Each job runs a headless Partitioner which spawns its own worker threads.
+   * Jobs beyond the maximum concurrent job count are queued. Results are
+   * available through the returned handle's future, and sig_jobFinished is
+   * also emitted for callers that prefer to receive results in their event
+   * loop.
+   */
+  class JobRunner : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    //! Constructor, the job slot count defaults to the ideal thread count.
+    JobRunner(int max_jobs=-1, QObject *parent=nullptr);
+
+    //! Destructor, waits for all submitted jobs to finish.
+    ~JobRunner();
+
+    /*! \brief Submit a job on a shared graph.
+     *
+     * Settings are altered for headless operation. Unless renumber_nets is 
+     * off, a graph not yet in local net order is renumbered into a new 
+     * shared graph for the job.
+     */
+    JobHandle submit(sp::GraphPtr graph, PSettings settings=PSettings());
+
+    //! Submit a job on a shared copy of the graph.
+    JobHandle submit(const sp::Graph &graph, const PSettings &settings=PSettings());
+
+    //! Set the maximum count of concurrently running jobs.
+    void setMaxConcurrentJobs(int max_jobs) {pool_.setMaxThreadCount(max_jobs);}
+
+    //! Return the maximum count of concurrently running jobs.
+    int maxConcurrentJobs() const {return pool_.maxThreadCount();}
+
+    //! Block until all submitted jobs have finished and signalled.
+    void waitForDone() {pool_.waitForDone();}
+
+    //! Return the application-wide runner.
+    static JobRunner *global();
+
+  signals:
+
+    //! Emitted from the job's thread when a job finishes.
+    void sig_jobFinished(quint64 job_id, pt::PResults results);
+
+  private:
+
+    QThreadPool pool_;            //!< Pool providing job slots.
+    std::atomic<quint64> next_id_;  //!< ID for the next submitted job.
+  };
+
+}
+
+#endif
@@ -6,23 +6,62 @@
   */
 
 #include "partitioner.h"
+#include "checkpoint.h"
+#include "estimator.h"
 #include <thread>
-#include <math.h>
+#include <algorithm>
+#include <cmath>
+#ifdef Q_OS_UNIX
+#include <time.h>
+#endif
 
 using namespace pt;
 
-#define fast_2_pow(expo) ((expo==0) ? 1LL : 1LL << ((quint64)expo))
+namespace {
 
-Partitioner::Partitioner(const sp::Graph &graph, const PSettings &settings)
-  : graph_(graph), settings_(settings), best_cost_(-1)
+  //! Return the CPU time used by the calling thread in ms, -1 if unknown.
+  qint64 threadCpuTime()
+  {
+#ifdef Q_OS_UNIX
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+      return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+#endif
+    return -1;
+  }
+
+}
+
+
+Partitioner::Partitioner(sp::GraphPtr graph, const PSettings &settings)
+  : graph_(graph), settings_(settings), ckpt_gen_(0), stop_reason_(Completed),
+    telem_ready_(false)
 {
   // set maximum block count in each partition
-  int numer = graph_.numBlocks();
+  int numer = graph_->numBlocks();
   if (numer % 2 == 1) {
     numer++;
   }
   max_blocks_in_part_ = std::llround(numer/2.);
 
+  // start with the provided incumbent if it is a feasible partition
+  if (!settings_.incumbent.isEmpty()) {
+    quint64 part_a_count = std::count(settings_.incumbent.cbegin(),
+        settings_.incumbent.cend(), 0);
+    quint64 part_b_count = std::count(settings_.incumbent.cbegin(),
+        settings_.incumbent.cend(), 1);
+    if (settings_.incumbent.size() == graph_->numBlocks()
+        && part_a_count + part_b_count == (quint64)graph_->numBlocks()
+        && part_a_count <= max_blocks_in_part_
+        && part_b_count <= max_blocks_in_part_) {
+      init_best_assignment_ = settings_.incumbent;
+      init_best_cost_ = sp::Chip::calcCost(*graph_, init_best_assignment_);
+    } else {
+      qWarning() << "Ignoring infeasible starting incumbent.";
+    }
+  }
+
   // set extra flags for headless mode
   if (settings_.headless) {
     settings_.no_dtv = true;
@@ -30,7 +69,7 @@ Partitioner::Partitioner(const sp::Graph &graph, const PSettings &settings)
 
   // status
   if (settings_.verbose) {
-    qDebug() << "Block count:" << graph_.numBlocks() << ", max in partition:" 
+    qDebug() << "Block count:" << graph_->numBlocks() << ", max in partition:" 
       << max_blocks_in_part_;
   }
 }
@@ -38,10 +77,17 @@ Partitioner::Partitioner(const sp::Graph &graph, const PSettings &settings)
 Partitioner::~Partitioner()
 {
   if (!threads.empty()) {
+    // workers hold a pointer to this partitioner so wait for them to stop
+    requestStop(Cancelled);
     for (auto &th : threads) {
-      th->quit();
+      th->wait();
     }
+    qDeleteAll(threads);
+    qDeleteAll(prune_mutex_);
+    qDeleteAll(stats_mutex_);
   }
+  delete trace_;
+  delete event_log_;
 }
 
 void Partitioner::runPartitioner()
@@ -49,45 +95,218 @@ void Partitioner::runPartitioner()
   // start wall timer
   wall_timer_.start();
 
-  // determine threads to spawn
-  quint64 actual_th = std::min(
-      {
-        (quint64)settings_.threads, 
-        (quint64)std::llround(pow(2, graph_.numBlocks()-2)),
-        (quint64)std::thread::hardware_concurrency()
-      });
-  split_at_bid_ = log2(actual_th); // ensure thread count is 2^x by casting to int
-  actual_th_count_ = pow(2, split_at_bid_);
-  if (graph_.numBlocks() <= split_at_bid_) {
-    split_at_bid_ = 0;
-  }
-
-  // initialize vars
-  QVector<int> curr_assignment, best_assignment;
-  curr_assignment.resize(graph_.numBlocks());
-  best_assignment.resize(graph_.numBlocks());
-  for (int i=0; i<curr_assignment.size(); i++) {
-    curr_assignment[i] = -1;
-    best_assignment[i] = -1;
-  }
+  // distribute the unexplored frontier to the threads to be spawned
+  QVector<QVector<ProblemNodeParams>> th_nodes = initialFrontier();
+  actual_th_count_ = th_nodes.size();
 
   // multi-threaded routine
-  int sleep_ms = (graph_.numBlocks() >= 70) ? 1000:100;
+  int sleep_ms = (graph_->numBlocks() >= 70) ? 1000:100;
   QVector<bool> finished;
   best_costs_.resize(actual_th_count_);
   best_assignments_.resize(actual_th_count_);
   bid_assignment_pairs_.resize(actual_th_count_);
-  visited_leaves_.resize(actual_th_count_);
-  pruned_leaves_.resize(actual_th_count_);
   finished.resize(actual_th_count_);
   remaining_th_ = actual_th_count_;
   prune_mutex_.clear();
+  for (quint64 tid=0; tid<actual_th_count_; tid++) {
+    prune_mutex_.append(new QMutex());
+    best_assignments_[tid].resize(graph_->numBlocks());
+    best_costs_[tid] = -1;
+    finished[tid] = false;
+  }
+
+  // carry over the incumbent and counters of a resumed search
+  telem_.reset(actual_th_count_);
+  if (init_best_cost_ >= 0) {
+    telem_.offerBestCost(init_best_cost_);
+    best_costs_[0] = init_best_cost_;
+    best_assignments_[0] = init_best_assignment_;
+  }
+  telem_.addVisitedLeaves(0, init_visited_);
+  telem_.addPrunedLeaves(0, init_pruned_);
+
+  // search budgets, check often enough that small node limits aren't overrun
+  budget_check_interval_ = 1024;
+  if (settings_.node_limit > 0) {
+    budget_check_interval_ = std::max((quint64)1, std::min(budget_check_interval_,
+          settings_.node_limit / (4*actual_th_count_)));
+  }
+  remaining_bounds_.fill(-1, actual_th_count_);
+  thread_cpu_time_.fill(-1, actual_th_count_);
+  thread_stats_.fill(SearchStats(), actual_th_count_);
+  thread_hw_.fill(HwCounters(), actual_th_count_);
+  thread_allocs_.fill(AllocCounts(), actual_th_count_);
+  thread_steady_allocs_.fill(AllocCounts(), actual_th_count_);
+  thread_steady_nodes_.fill(0, actual_th_count_);
+  gui_allocs_start_ = AllocAccounting::threadCounts(AllocAccounting::GuiEmit);
+  stats_mutex_.clear();
+  for (quint64 tid=0; tid<actual_th_count_; tid++) {
+    thread_stats_[tid].init(graph_->numBlocks());
+    stats_mutex_.append(new QMutex());
+  }
+
+  // checkpointing states
+  ckpt_posted_gen_.fill(0, actual_th_count_);
+  ckpt_stacks_.resize(actual_th_count_);
+  ckpt_best_costs_.resize(actual_th_count_);
+  ckpt_best_assignments_.resize(actual_th_count_);
+  ckpt_visited_.resize(actual_th_count_);
+  ckpt_pruned_.resize(actual_th_count_);
+  ckpt_timer_.start();
+
+  // one trace slot per worker and one for this thread
+  if (!settings_.trace_path.isEmpty()) {
+    QStringList slot_names;
+    for (quint64 tid=0; tid<actual_th_count_; tid++) {
+      slot_names.append(QString("worker %1").arg(tid));
+    }
+    slot_names.append("main");
+    delete trace_;
+    trace_ = new TraceRecorder(slot_names);
+    main_slot_ = actual_th_count_;
+    last_gui_update_ = -1;
+    gui_update_interval_ = sleep_ms;
+  }
+  // workers log search events through per-thread buffers in verbose mode
+  if (settings_.verbose) {
+    QVector<EventLimit> limits = EventLog::defaultLimits();
+    if (!EventLog::parseLimits(settings_.log_limits, limits)) {
+      qWarning() << "Using the default event log limits";
+      limits = EventLog::defaultLimits();
+    }
+    delete event_log_;
+    event_log_ = new EventLog(actual_th_count_, graph_->numBlocks(),
+        settings_.log_path, settings_.log_text, limits);
+  }
+  telem_ready_.store(true, std::memory_order_release);
+
+  // nothing to search if the incumbent already meets the known bound
+  if (settings_.known_lower_bound >= 0 && init_best_cost_ >= 0
+      && init_best_cost_ <= settings_.known_lower_bound) {
+    requestStop(BoundReached);
+  }
+
   qDebug() << QObject::tr("Spawning %1 threads").arg(actual_th_count_);
+  for (quint64 tid=0; tid<actual_th_count_; tid++) {
+    // spawn threads
+    PartitionerThread *worker_th = new PartitionerThread(tid, graph_, settings_, 
+        th_nodes[tid], &best_assignments_[tid], &best_costs_[tid], this);
+    worker_th->start();
+    threads.append(worker_th);
+    if (!settings_.headless) {
+      connect(worker_th, &QThread::finished, this, &Partitioner::processCompletedThread);
+    }
+  }
+
+  // set up timer to update GUI periodically while the workers run
+  if (!settings_.headless) {
+    qDebug() << "Setting up GUI update timer";
+    gui_update_timer_ = new QTimer(this);
+    connect(gui_update_timer_, &QTimer::timeout, [this](){
+        sendGuiUpdates();
+        checkpointTick();
+        });
+    gui_update_timer_->start(sleep_ms);
+  }
+
+  qDebug() << "Workers setup complete. Wait for completion.";
+
+  if (settings_.headless) {
+    // complete every thread so that the results are packaged after the last
+    for (auto &th : threads) {
+      while (!th->wait(100)) {
+        checkpointTick();
+      }
+      processCompletedThread();
+    }
+    qDebug() << "Headless partitioning complete.";
+  }
+}
+
+QVector<QVector<ProblemNodeParams>> Partitioner::initialFrontier()
+{
+  // determine the maximum number of threads to spawn
+  quint64 max_th = std::min((quint64)settings_.threads,
+      (quint64)std::max(1u, std::thread::hardware_concurrency()));
+  int n_free_levels = graph_->numBlocks() - 2;
+  if (n_free_levels < 63) {
+    // the tree can't be split into more subtrees than it has below the root
+    max_th = std::min(max_th, (n_free_levels > 0) ? 1ULL << n_free_levels : 1ULL);
+  }
+  max_th = std::max(max_th, (quint64)1);
+
+  QVector<QVector<ProblemNodeParams>> th_nodes;
+  QVector<int> net_costs(graph_->numNets(), -1);
+
+  // resume from checkpoint, distributing the frontier round-robin so that any
+  // thread count can be used
+  if (!settings_.resume_path.isEmpty()) {
+    Checkpoint ckpt;
+    if (!Checkpoint::read(settings_.resume_path, ckpt)) {
+      qWarning() << "Failed to read checkpoint, starting a fresh search.";
+    } else if (ckpt.num_blocks != graph_->numBlocks()
+        || ckpt.num_nets != graph_->numNets()
+        || ckpt.graph_hash != graph_->canonicalHash()) {
+      qWarning() << "Checkpoint does not match the problem graph, starting a "
+        "fresh search.";
+    } else {
+      qDebug() << QObject::tr("Resuming from checkpoint with %1 unexplored "
+          "nodes").arg(ckpt.frontier.size());
+      if (ckpt.best_cost >= 0
+          && (init_best_cost_ < 0 || ckpt.best_cost < init_best_cost_)) {
+        init_best_cost_ = ckpt.best_cost;
+        init_best_assignment_ = ckpt.best_assignment;
+      }
+      init_visited_ = ckpt.visited_leaves;
+      init_pruned_ = ckpt.pruned_leaves;
+      // split the shallowest nodes if there are fewer than threads available
+      while ((quint64)ckpt.frontier.size() < max_th) {
+        int split_i = -1;
+        for (int i=0; i<ckpt.frontier.size(); i++) {
+          const ProblemNodeParams &p = ckpt.frontier[i];
+          bool mirror_half = settings_.prune_half && p.bid == 1 
+            && p.assignment[0] == 1;
+          if (p.bid < graph_->numBlocks() && !mirror_half
+              && (split_i < 0 || p.bid < ckpt.frontier[split_i].bid)) {
+            split_i = i;
+          }
+        }
+        if (split_i < 0) {
+          break;
+        }
+        ProblemNodeParams p = ckpt.frontier.takeAt(split_i);
+        QVector<int> assignment = p.assignment;
+        assignment[p.bid] = 1;
+        ckpt.frontier.insert(split_i, ProblemNodeParams::fromPrefix(assignment,
+              p.bid+1, net_costs));
+        assignment[p.bid] = 0;
+        ckpt.frontier.insert(split_i+1, ProblemNodeParams::fromPrefix(assignment,
+              p.bid+1, net_costs));
+      }
+      int n_th = std::max(1, (int)std::min(max_th, (quint64)ckpt.frontier.size()));
+      th_nodes.resize(n_th);
+      for (int i=0; i<ckpt.frontier.size(); i++) {
+        th_nodes[i % n_th].append(ckpt.frontier[i]);
+      }
+      split_at_bid_ = -1;
+      return th_nodes;
+    }
+  }
+
+  // fresh search, pre-assign the first split_at_bid_ blocks to split the tree
+  // evenly among 2^split_at_bid_ threads
+  split_at_bid_ = log2(max_th); // ensure thread count is 2^x by casting to int
+  quint64 n_th = 1ULL << split_at_bid_;
+  if (graph_->numBlocks() <= split_at_bid_) {
+    split_at_bid_ = 0;
+  }
+  QVector<int> curr_assignment(graph_->numBlocks(), -1);
   // init curr assignment list
   for (int i=0; i<=split_at_bid_; i++) {
     curr_assignment[i] = 0;
   }
-  for (quint64 tid=0; tid<actual_th_count_; tid++) {
+  th_nodes.resize(n_th);
+  for (quint64 tid=0; tid<n_th; tid++) {
     // pre-assignments
     bool carry=true;
     // increment curr assignment list
@@ -106,39 +325,45 @@ void Partitioner::runPartitioner()
       }
     }
     qDebug() << curr_assignment;
-    // spawn threads
-    prune_mutex_.append(new QMutex());
-    best_assignments_[tid].resize(graph_.numBlocks());
-    best_costs_[tid] = -1;
-    finished[tid] = false;
-    visited_leaves_[tid] = 0;
-    PartitionerThread *worker_th = new PartitionerThread(tid, graph_, settings_, 
-        curr_assignment, split_at_bid_+1, &best_assignments_[tid], &best_costs_[tid],
-        this);
-    worker_th->start();
-    threads.append(worker_th);
-    if (!settings_.headless) {
-      connect(worker_th, &QThread::finished, this, &Partitioner::processCompletedThread);
-    }
+    th_nodes[tid].append(ProblemNodeParams::fromPrefix(curr_assignment,
+          split_at_bid_+1, net_costs));
   }
 
-  // set up timer to update GUI periodically while the workers run
-  if (!settings_.headless) {
-    qDebug() << "Setting up GUI update timer";
-    gui_update_timer_ = new QTimer(this);
-    connect(gui_update_timer_, &QTimer::timeout, [this](){sendGuiUpdates();});
-    gui_update_timer_->start(sleep_ms);
+  // for the 0-th thread, also visit right branch to prune it
+  if (settings_.prune_half) {
+    QVector<int> right_assignment(graph_->numBlocks(), -1);
+    right_assignment[0] = 1;
+    th_nodes[0].append(ProblemNodeParams::fromPrefix(right_assignment, 1,
+          net_costs));
   }
+  return th_nodes;
+}
 
-  qDebug() << "Workers setup complete. Wait for completion.";
+PProgress Partitioner::progress() const
+{
+  PProgress prog;
+  if (!telem_ready_.load(std::memory_order_acquire)) {
+    return prog;
+  }
+  TelemetrySnapshot snap = telem_.snapshot();
+  prog.state = (remaining_th_.load() > 0) ? PProgress::Running
+    : PProgress::Finished;
+  prog.nodes = snap.nodes;
+  prog.visited_leaves = snap.visited_leaves;
+  prog.pruned_leaves = snap.pruned_leaves;
+  prog.best_cut_size = snap.best_cut_size;
+  prog.elapsed = wall_timer_.elapsed();
+  prog.fraction_done = snap.fractionDone();
+  prog.eta = snap.eta(prog.elapsed);
+  return prog;
+}
 
-  if (settings_.headless) {
-    for (auto &th : threads) {
-      th->wait();
-    }
-    qDebug() << "Headless partitioning complete.";
-    processCompletedThread();
+TelemetrySnapshot Partitioner::telemetry() const
+{
+  if (!telem_ready_.load(std::memory_order_acquire)) {
+    return TelemetrySnapshot();
   }
+  return telem_.snapshot();
 }
 
 void Partitioner::newPrune(int tid, int bid, const QVector<int> &assignments)
@@ -155,29 +380,39 @@ void Partitioner::newPrune(int tid, int bid, const QVector<int> &assignments)
     // thread-safe way to enqueue prune GUI updates, but rely on main loop to 
     // actually emit the changes
     if (!(settings_.no_dtv || settings_.headless)) {
+      qint64 wait_start = (trace_ != nullptr) ? trace_->now() : 0;
       QMutexLocker locker(prune_mutex_[tid]);
+      if (trace_ != nullptr) {
+        trace_->span(tid, "prune lock wait", wait_start);
+      }
       bid_assignment_pairs_[tid].enqueue(qMakePair(bid, assignments));
     }
   }
   if (!settings_.no_pie) {
     if (tid < 0) tid = 0;
-    pruned_leaves_[tid] += std::llround(fast_2_pow(graph_.numBlocks()-bid));
+    // exact while the pruned subtrees are within 53 bits of each other in
+    // size, which is plenty for telemetry on trees of any depth up to ~1000
+    telem_.addPrunedLeaves(tid, std::ldexp(1., graph_->numBlocks()-bid));
   }
 }
 
 void Partitioner::leafReachedExchange(int tid, int *local_best_cost, int &global_best_cost)
 {
   if (tid < 0) tid = 0;
-  if (bestCost() < 0 || (*local_best_cost >= 0 && *local_best_cost < bestCost())) {
-    setBestCost(*local_best_cost);
-  }
-  if (global_best_cost < 0 || bestCost() < global_best_cost){
-    global_best_cost = bestCost();
+  if (*local_best_cost >= 0 && telem_.offerBestCost(*local_best_cost)) {
+    if (trace_ != nullptr) {
+      trace_->instant(tid, "incumbent improved");
+      trace_->counter(tid, "best cut", *local_best_cost);
+    }
+    if (settings_.known_lower_bound >= 0 && *local_best_cost <= settings_.known_lower_bound) {
+      requestStop(BoundReached);
+    }
   }
-  visited_leaves_[tid]++;
-  if (tid == -1 && !settings_.headless) {
-    emit sig_updateTelem(visited_leaves_[0], pruned_leaves_[0], best_cost_);
+  int best_cost = telem_.bestCost();
+  if (global_best_cost < 0 || best_cost < global_best_cost){
+    global_best_cost = best_cost;
   }
+  telem_.addVisitedLeaves(tid, 1);
 }
 
 void Partitioner::processCompletedThread()
@@ -189,10 +424,19 @@ void Partitioner::processCompletedThread()
   if (--remaining_th_ == 0) {
     // all done, wrap up
     qDebug() << "All threads have completed. Processing completion actions...";
+    if (event_log_ != nullptr) {
+      event_log_->close();
+    }
     if (!settings_.headless) {
       gui_update_timer_->stop();
     }
     qint64 elapsed_time = wall_timer_.elapsed();
+    // sum the workers' own clocks, the process clock would also count other
+    // jobs running alongside this one
+    qint64 cpu_time = 0;
+    for (qint64 th_cpu_time : thread_cpu_time_) {
+      cpu_time = (th_cpu_time >= 0 && cpu_time >= 0) ? cpu_time + th_cpu_time : -1;
+    }
 
     qDebug() << "Tidying up after partitioning";
     sendGuiUpdates(true);
@@ -202,22 +446,130 @@ void Partitioner::processCompletedThread()
     int best_cost = -1;
     QVector<int> best_assignment;
     for (quint64 tid=0; tid<actual_th_count_; tid++) {
-      if (best_cost == -1 || best_costs_[tid] >= 0) {
+      if (best_costs_[tid] >= 0 && (best_cost == -1 || best_costs_[tid] < best_cost)) {
         best_cost = best_costs_[tid];
         best_assignment = best_assignments_[tid];
       }
     }
 
-    if (!settings_.headless) {
-      // emit the best partition
-      emit sig_bestPart(&graph_, best_assignment, elapsed_time);
+    // the optimum can't be lower than the incumbent or any unexplored node
+    int lower_bound = best_cost;
+    for (int bound : remaining_bounds_) {
+      if (bound >= 0 && (lower_bound < 0 || bound < lower_bound)) {
+        lower_bound = bound;
+      }
+    }
+    lower_bound = std::max(lower_bound, settings_.known_lower_bound);
+    if (best_cost >= 0) {
+      lower_bound = std::min(lower_bound, best_cost);
+    }
+
+    // package the results
+    results_ = PResults();
+    results_.best_cut_size = best_cost;
+    results_.best_assignment = best_assignment;
+    TelemetrySnapshot snap = telem_.snapshot();
+    results_.visited_leaves = snap.visited_leaves;
+    results_.pruned_leaves = snap.pruned_leaves;
+    results_.nodes = snap.nodes;
+    results_.wall_time = elapsed_time;
+    results_.cpu_time = cpu_time;
+    results_.threads = actual_th_count_;
+    results_.split_depth = split_at_bid_;
+    results_.thread_nodes = snap.thread_nodes;
+    results_.thread_visited_leaves = snap.thread_visited_leaves;
+    results_.thread_pruned_leaves = snap.thread_pruned_leaves;
+    results_.thread_stats = thread_stats_;
+    results_.stats = searchStats();
+    if (settings_.hw_counters) {
+      results_.thread_hw = thread_hw_;
+      results_.hw = thread_hw_.value(0);
+      for (int tid=1; tid<thread_hw_.size(); tid++) {
+        results_.hw.merge(thread_hw_[tid]);
+      }
+      if (!results_.hw.isValid()) {
+        qWarning() << "Hardware counters are unavailable, check"
+          " /proc/sys/kernel/perf_event_paranoid";
+      }
+    }
+    if (AllocAccounting::enabled()) {
+      results_.thread_allocs = thread_allocs_;
+      for (int tid=0; tid<thread_allocs_.size(); tid++) {
+        results_.search_allocs.merge(thread_allocs_[tid]);
+        results_.steady_allocs.merge(thread_steady_allocs_[tid]);
+        results_.steady_nodes += thread_steady_nodes_[tid];
+      }
+      results_.gui_allocs = AllocAccounting::threadCounts(AllocAccounting::GuiEmit)
+        - gui_allocs_start_;
+    }
+    results_.stop_reason = (StopReason)stop_reason_.load();
+    if (results_.stop_reason == Completed) {
+      results_.fraction_done = 1;
+      results_.eta = 0;
     } else {
-      // emit the result package
-      PResults results;
-      results.best_cut_size = best_cost;
-      results.wall_time = elapsed_time;
-      emit sig_packagedResults(results);
+      results_.fraction_done = snap.fractionDone();
+      results_.eta = snap.eta(elapsed_time);
+    }
+    results_.lower_bound = lower_bound;
+    results_.proven_optimal = best_cost >= 0 && lower_bound >= best_cost;
+    if (best_cost > 0) {
+      results_.gap = (double)(best_cost - lower_bound) / best_cost;
+    } else if (best_cost == 0) {
+      results_.gap = 0;
+    }
+    if (settings_.verbose) {
+      const SearchStats &stats = results_.stats;
+      qDebug() << "Expanded nodes:" << stats.expanded_nodes << "visited leaves:"
+        << stats.visited_leaves << "max stack depth:" << stats.max_stack_depth;
+      qDebug() << "Prunes by imbalance:" << stats.prunes(ImbalancePrune)
+        << "mirroring:" << stats.prunes(MirrorPrune) << "cost:"
+        << stats.prunes(CostPrune);
+      for (int tid=0; tid<thread_stats_.size(); tid++) {
+        qDebug() << QString("Thread %1: %2 nodes, %3 expanded, %4 leaves, %5 "
+            "prunes, max stack depth %6").arg(tid).arg(snap.thread_nodes[tid])
+          .arg(thread_stats_[tid].expanded_nodes)
+          .arg(thread_stats_[tid].visited_leaves)
+          .arg(thread_stats_[tid].totalPrunes())
+          .arg(thread_stats_[tid].max_stack_depth);
+      }
+      if (AllocAccounting::enabled()) {
+        qDebug() << QString("Search allocations: %1 (%2 bytes), %3 per expanded "
+            "node in steady state").arg(results_.search_allocs.allocs)
+          .arg(results_.search_allocs.bytes)
+          .arg(results_.steady_allocs.perNode(results_.steady_nodes), 0, 'f', 3);
+      }
+      if (results_.hw.isValid()) {
+        qDebug() << QString("IPC %1, per expanded node: %2 instructions, %3 "
+            "cache misses, %4 branch misses").arg(results_.hw.ipc(), 0, 'f', 2)
+          .arg(results_.hw.perNode(HwCounters::Instructions, stats.expanded_nodes), 0, 'f', 1)
+          .arg(results_.hw.perNode(HwCounters::CacheMisses, stats.expanded_nodes), 0, 'f', 3)
+          .arg(results_.hw.perNode(HwCounters::BranchMisses, stats.expanded_nodes), 0, 'f', 3);
+      }
+    }
+    if (!results_.proven_optimal) {
+      qDebug() << QObject::tr("Search stopped early with lower bound %1, gap %2")
+        .arg(lower_bound).arg(results_.gap);
+    }
+
+    // leave a checkpoint behind so a stopped search can be continued
+    if (!results_.proven_optimal && !settings_.checkpoint_path.isEmpty()) {
+      Checkpoint ckpt;
+      if (collectCheckpoint(ckpt)) {
+        ckpt.write(settings_.checkpoint_path);
+      }
+    }
+
+    if (!settings_.headless && best_cost >= 0) {
+      // emit the best partition
+      emit sig_bestPart(graph_, best_assignment, elapsed_time);
+    }
+
+    if (trace_ != nullptr && trace_->write(settings_.trace_path)) {
+      qDebug() << "Wrote trace to" << settings_.trace_path;
     }
+
+    // emit the result package
+    emit sig_packagedResults(results_);
   }
 
   complete_mutex_.unlock();
@@ -226,35 +578,270 @@ void Partitioner::processCompletedThread()
 void Partitioner::sendGuiUpdates(bool emit_all)
 {
   if (!settings_.headless) {
+    qint64 update_start = 0;
+    if (trace_ != nullptr) {
+      // flag updates that come late because the event loop was busy
+      update_start = trace_->now();
+      if (last_gui_update_ >= 0
+          && update_start - last_gui_update_ > 2000000 * gui_update_interval_) {
+        trace_->instant(main_slot_, "gui stall");
+      }
+      last_gui_update_ = update_start;
+    }
     emitPrunedBranches(emit_all);
-    emit sig_updateTelem(visitedLeafCount(), prunedLeafCount(), best_cost_);
+    TelemetrySnapshot snap = telem_.snapshot();
+    emit sig_updateTelem(snap.visited_leaves, snap.pruned_leaves,
+        snap.best_cut_size, snap.fractionDone(), snap.eta(wall_timer_.elapsed()));
+    emit sig_updateStats(searchStats(), snap.thread_nodes);
+    if (trace_ != nullptr) {
+      trace_->span(main_slot_, "gui update", update_start);
+    }
   }
 }
 
 void Partitioner::emitPrunedBranches(bool emit_all)
 {
+  AllocAccounting::Scope alloc_scope(AllocAccounting::GuiEmit);
   if (!settings_.no_dtv && !settings_.headless) {
     for (quint64 tid=0; tid<actual_th_count_; tid++) {
       if (emit_all || bid_assignment_pairs_[tid].size() >= settings_.gui_update_batch) {
         // copy the prune queue then emit
         // sacrificing memory efficiency for shorter lock time
+        qint64 emit_start = (trace_ != nullptr) ? trace_->now() : 0;
         prune_mutex_[tid]->lock();
+        if (trace_ != nullptr) {
+          trace_->span(main_slot_, "prune lock wait", emit_start);
+        }
         auto queue_copy = bid_assignment_pairs_[tid];
         bid_assignment_pairs_[tid].clear();
         prune_mutex_[tid]->unlock();
         emit sig_pruned(&queue_copy);
+        if (trace_ != nullptr) {
+          trace_->span(main_slot_, "gui prune batch", emit_start);
+        }
       }
     }
   }
 }
 
+void Partitioner::postCheckpointState(int tid, int gen,
+    const QStack<ProblemNodeParams> &stack)
+{
+  QMutexLocker locker(&ckpt_mutex_);
+  ckpt_posted_gen_[tid] = gen;
+  ckpt_stacks_[tid] = stack;
+  ckpt_best_costs_[tid] = best_costs_[tid];
+  ckpt_best_assignments_[tid] = best_assignments_[tid];
+  ckpt_visited_[tid] = telem_.visitedLeaves(tid);
+  ckpt_pruned_[tid] = telem_.prunedLeaves(tid);
+}
+
+void Partitioner::checkpointTick()
+{
+  if (settings_.checkpoint_path.isEmpty()) {
+    return;
+  }
+
+  // ask workers to post their states once the interval has passed
+  if (!ckpt_pending_) {
+    if (ckpt_timer_.elapsed() >= settings_.checkpoint_interval * 1000LL) {
+      ckpt_gen_.fetch_add(1, std::memory_order_relaxed);
+      ckpt_pending_ = true;
+    }
+    return;
+  }
+
+  // assemble the checkpoint once every worker has posted or finished
+  Checkpoint ckpt;
+  if (!collectCheckpoint(ckpt)) {
+    return;
+  }
+  qint64 write_start = (trace_ != nullptr) ? trace_->now() : 0;
+  bool written = ckpt.write(settings_.checkpoint_path);
+  if (trace_ != nullptr) {
+    trace_->span(main_slot_, "checkpoint write", write_start);
+  }
+  if (written && settings_.verbose) {
+    qDebug() << QObject::tr("Wrote checkpoint with %1 unexplored nodes to %2")
+      .arg(ckpt.frontier.size()).arg(settings_.checkpoint_path);
+  }
+  ckpt_pending_ = false;
+  ckpt_timer_.restart();
+}
+
+bool Partitioner::collectCheckpoint(Checkpoint &ckpt)
+{
+  int gen = checkpointGeneration();
+  ckpt.num_blocks = graph_->numBlocks();
+  ckpt.num_nets = graph_->numNets();
+  ckpt.graph_hash = graph_->canonicalHash();
+  QMutexLocker locker(&ckpt_mutex_);
+  for (int posted_gen : ckpt_posted_gen_) {
+    if (posted_gen != gen && posted_gen != -1) {
+      return false;
+    }
+  }
+  for (quint64 tid=0; tid<actual_th_count_; tid++) {
+    ckpt.frontier += ckpt_stacks_[tid];
+    ckpt.visited_leaves += ckpt_visited_[tid];
+    ckpt.pruned_leaves += ckpt_pruned_[tid];
+    int th_best = ckpt_best_costs_[tid];
+    if (th_best >= 0 && (ckpt.best_cost < 0 || th_best < ckpt.best_cost)) {
+      ckpt.best_cost = th_best;
+      ckpt.best_assignment = ckpt_best_assignments_[tid];
+    }
+  }
+  return true;
+}
+
+bool Partitioner::accountNodes(int tid, quint64 n, bool enforce_budgets)
+{
+  telem_.addNodes(tid, n);
+  if (!enforce_budgets) {
+    return !stopRequested();
+  }
+  if (settings_.node_limit > 0 && telem_.totalNodes() >= settings_.node_limit) {
+    requestStop(NodeLimit);
+  }
+  if (settings_.time_limit >= 0 && wall_timer_.elapsed() >= settings_.time_limit) {
+    requestStop(TimeLimit);
+  }
+  return !stopRequested();
+}
+
+void Partitioner::postSearchStats(int tid, const SearchStats &stats)
+{
+  qint64 wait_start = (trace_ != nullptr) ? trace_->now() : 0;
+  QMutexLocker locker(stats_mutex_[tid]);
+  if (trace_ != nullptr) {
+    trace_->span(tid, "stats lock wait", wait_start);
+  }
+  // copy into the preallocated histograms, sharing them would make the
+  // worker reallocate its own on its next increment
+  thread_stats_[tid].copyFrom(stats);
+}
+
+void Partitioner::postHwCounters(int tid, const HwCounters &counters)
+{
+  QMutexLocker locker(stats_mutex_[tid]);
+  thread_hw_[tid] = counters;
+}
+
+void Partitioner::postAllocCounts(int tid, const AllocCounts &search,
+    const AllocCounts &steady, quint64 steady_nodes)
+{
+  QMutexLocker locker(stats_mutex_[tid]);
+  thread_allocs_[tid] = search;
+  thread_steady_allocs_[tid] = steady;
+  thread_steady_nodes_[tid] = steady_nodes;
+}
+
+SearchStats Partitioner::searchStats() const
+{
+  SearchStats stats;
+  stats.init(graph_->numBlocks());
+  if (!telem_ready_.load(std::memory_order_acquire)) {
+    return stats;
+  }
+  for (int tid=0; tid<thread_stats_.size(); tid++) {
+    QMutexLocker locker(stats_mutex_[tid]);
+    stats.merge(thread_stats_[tid]);
+  }
+  return stats;
+}
+
+void Partitioner::requestStop(StopReason reason)
+{
+  int running = Completed;
+  stop_reason_.compare_exchange_strong(running, reason);
+}
+
+// stats implementation
+void SearchStats::init(int n_blocks)
+{
+  for (QVector<quint64> &hist : prunes_by_depth) {
+    hist.fill(0, n_blocks + 1);
+  }
+  expanded_by_depth.fill(0, n_blocks + 1);
+}
+
+quint64 SearchStats::prunes(PruneReason reason) const
+{
+  return std::accumulate(prunes_by_depth[reason].cbegin(),
+      prunes_by_depth[reason].cend(), (quint64)0);
+}
+
+quint64 SearchStats::totalPrunes() const
+{
+  quint64 total = 0;
+  for (int reason=0; reason<NumPruneReasons; reason++) {
+    total += prunes((PruneReason)reason);
+  }
+  return total;
+}
+
+void SearchStats::copyFrom(const SearchStats &other)
+{
+  expanded_nodes = other.expanded_nodes;
+  visited_leaves = other.visited_leaves;
+  max_stack_depth = other.max_stack_depth;
+  auto copy_hist = [](QVector<quint64> &hist, const QVector<quint64> &other_hist)
+  {
+    if (hist.size() != other_hist.size()) {
+      hist.resize(other_hist.size());
+    }
+    std::copy(other_hist.cbegin(), other_hist.cend(), hist.begin());
+  };
+  for (int reason=0; reason<NumPruneReasons; reason++) {
+    copy_hist(prunes_by_depth[reason], other.prunes_by_depth[reason]);
+  }
+  copy_hist(expanded_by_depth, other.expanded_by_depth);
+}
+
+void SearchStats::merge(const SearchStats &other)
+{
+  expanded_nodes += other.expanded_nodes;
+  visited_leaves += other.visited_leaves;
+  max_stack_depth = std::max(max_stack_depth, other.max_stack_depth);
+  auto merge_hist = [](QVector<quint64> &hist, const QVector<quint64> &other_hist)
+  {
+    if (hist.size() < other_hist.size()) {
+      hist.resize(other_hist.size());
+    }
+    for (int depth=0; depth<other_hist.size(); depth++) {
+      hist[depth] += other_hist[depth];
+    }
+  };
+  for (int reason=0; reason<NumPruneReasons; reason++) {
+    merge_hist(prunes_by_depth[reason], other.prunes_by_depth[reason]);
+  }
+  merge_hist(expanded_by_depth, other.expanded_by_depth);
+}
+
+// node implementation
+ProblemNodeParams ProblemNodeParams::fromPrefix(const QVector<int> &assignment,
+    int bid, const QVector<int> &net_costs)
+{
+  quint64 part_a_count = 0;
+  quint64 part_b_count = 0;
+  for (int i=0; i<bid; i++) {
+    if (assignment[i] == 0) {
+      part_a_count++;
+    } else if (assignment[i] == 1) {
+      part_b_count++;
+    } else {
+      qFatal("Partition node encountered unassigned block.");
+    }
+  }
+  return ProblemNodeParams(assignment, bid, part_a_count, part_b_count, net_costs);
+}
+
 // thread implementation
-PartitionerThread::PartitionerThread(int tid, const sp::Graph &graph, 
-    PSettings settings, QVector<int> curr_assignment, 
-    int start_bid, QVector<int> *best_assignment, int *local_best_cost, 
-    Partitioner *parent)
-  :  tid_(tid), graph_(graph), settings_(settings), init_assignment_(curr_assignment),
-     start_bid_(start_bid), best_assignment_(best_assignment),
+PartitionerThread::PartitionerThread(int tid, sp::GraphPtr graph, 
+    PSettings settings, const QVector<ProblemNodeParams> &init_nodes,
+    QVector<int> *best_assignment, int *local_best_cost, Partitioner *parent)
+  :  tid_(tid), graph_(graph), settings_(settings), init_nodes_(init_nodes),
+     best_assignment_(best_assignment),
      local_best_cost_(local_best_cost), parent_(parent)
 {
 }
@@ -267,78 +854,132 @@ void PartitionerThread::run()
 void PartitionerThread::traverseProblemSpace()
 {
   QStack<ProblemNodeParams> problem_stack;
-
-  // init
-  quint64 init_part_a_count = 0;
-  quint64 init_part_b_count = 0;
-  for (int i=0; i<start_bid_; i++) {
-    if (init_assignment_[i] == 0) {
-      init_part_a_count++;
-    } else if (init_assignment_[i] == 1) {
-      init_part_b_count++;
-    } else {
-      qFatal("Partition thread encountered unassigned block.");
-    }
-  }
+  const sp::Graph &graph = *graph_;
 
   // tracking vars
-  int global_best_cost = -1;
-  QVector<int> net_costs(graph_.numNets(), -1);
+  int global_best_cost = parent_->bestCost();
+  int ckpt_gen = 0;
+  quint64 unaccounted_nodes = 0;
+  qint64 cpu_start = threadCpuTime();
+  SearchStats stats;
+  stats.init(graph.numBlocks());
+  WorkEstimator estimator(graph.numBlocks());
 
-  // init problem
-  ProblemNodeParams p_init(init_assignment_, start_bid_, init_part_a_count, 
-      init_part_b_count, net_costs);
-  problem_stack.push(p_init);
+  // each initial node's subtree is done once the stack shrinks back below it
+  TraceRecorder *trace = parent_->trace();
+  qint64 search_start = (trace != nullptr) ? trace->now() : 0;
+  qint64 subtree_start = -1;
+  int subtree_base = 0;
 
-  // for the 0-th thread, also visit right branch to prune it
-  if (tid_ == 0 && settings_.prune_half) {
-    ProblemNodeParams p_r(init_assignment_, 1, 0, 1, net_costs);
-    p_r.assignment[0] = 1;
-    problem_stack.push(p_r);
+  // verbose events go through this thread's log buffer
+  EventLog *event_log = parent_->eventLog();
+
+  // heap activity of the search, the steady state begins at the first
+  // budget check once the stack and frontier have grown
+  AllocAccounting::Scope alloc_scope(AllocAccounting::Search);
+  AllocCounts allocs_start = AllocAccounting::threadCounts(AllocAccounting::Search);
+  AllocCounts allocs_steady_start;
+  quint64 steady_start_nodes = 0;
+  bool steady = false;
+
+  // counters are per thread so they must be opened here
+  QScopedPointer<PerfCounters> perf;
+  if (settings_.hw_counters) {
+    perf.reset(new PerfCounters());
+    perf->start();
+  }
+
+  // init problems, the last one is explored first
+  for (const ProblemNodeParams &p_init : init_nodes_) {
+    problem_stack.push(p_init);
   }
 
   // traverse
   while (!problem_stack.isEmpty()) {
+    // stop cooperatively on cancellation or exhausted budgets
+    if (parent_->stopRequested()) {
+      break;
+    }
+    if (++unaccounted_nodes >= parent_->budgetCheckInterval()) {
+      parent_->accountNodes(tid_, unaccounted_nodes);
+      parent_->postSearchStats(tid_, stats);
+      estimator.update(stats);
+      parent_->postRemainingWork(tid_, estimator.remainingNodes(problem_stack));
+      unaccounted_nodes = 0;
+      if (trace != nullptr) {
+        trace->counter(tid_, "expanded nodes", stats.expanded_nodes);
+      }
+      if (!steady) {
+        allocs_steady_start = AllocAccounting::threadCounts(AllocAccounting::Search);
+        steady_start_nodes = stats.expanded_nodes;
+        steady = true;
+      }
+    }
+    if (trace != nullptr) {
+      if (subtree_start >= 0 && problem_stack.size() <= subtree_base) {
+        trace->span(tid_, "subproblem", subtree_start);
+        subtree_start = -1;
+      }
+      if (subtree_start < 0 && problem_stack.size() <= init_nodes_.size()) {
+        subtree_start = trace->now();
+        subtree_base = problem_stack.size() - 1;
+      }
+    }
+
+    // hand over the pending stack if a checkpoint has been requested
+    if (parent_->checkpointGeneration() != ckpt_gen) {
+      ckpt_gen = parent_->checkpointGeneration();
+      qint64 post_start = (trace != nullptr) ? trace->now() : 0;
+      parent_->postCheckpointState(tid_, ckpt_gen, problem_stack);
+      if (trace != nullptr) {
+        trace->span(tid_, "checkpoint post", post_start);
+      }
+    }
+
     ProblemNodeParams p = problem_stack.pop();
     if (p.part_a_count > parent_->maxBlocksInPart()
         || p.part_b_count > parent_->maxBlocksInPart()) {
       // prune imbalance branch
-      if (parent_->settings().verbose) {
-        qDebug() << "Pruned imbalance branch at" << p.assignment;
+      if (event_log != nullptr) {
+        event_log->log(tid_, ImbalancePruneEvent, p.bid, p.cut_size, p.assignment);
       }
+      stats.prunes_by_depth[ImbalancePrune][p.bid]++;
       parent_->newPrune(tid_, p.bid, p.assignment);
       continue;
     } else if (parent_->settings().prune_half && p.bid==1 && p.assignment[0]==1) {
       // prune right half of the tree as it's just a mirror of the left half
-      if (parent_->settings().verbose) {
-        qDebug() << "Pruned right half of the tree.";
+      if (event_log != nullptr) {
+        event_log->log(tid_, MirrorPruneEvent, p.bid, p.cut_size, p.assignment);
       }
+      stats.prunes_by_depth[MirrorPrune][p.bid]++;
       parent_->newPrune(tid_, p.bid, p.assignment);
       continue;
     }
 
     if (p.cut_size < 0) {
-      p.cut_size = sp::Chip::calcCost(parent_->graph(), p.assignment);
+      p.cut_size = sp::Chip::calcCost(graph, p.assignment);
     } else if (settings_.sanity_check) {
-      int true_cut_size = sp::Chip::calcCost(parent_->graph(), p.assignment);
+      int true_cut_size = sp::Chip::calcCost(graph, p.assignment);
       if (p.cut_size != true_cut_size) {
         qWarning() << QString("Delta cut-size %1 is different from calculated "
             "cut size %2").arg(p.cut_size).arg(true_cut_size) << p.assignment;
-        p.cut_size = sp::Chip::calcCost(parent_->graph(), p.assignment);
+        p.cut_size = sp::Chip::calcCost(graph, p.assignment);
       }
     }
-    if (p.bid != parent_->graph().numBlocks() && parent_->settings().prune_by_cost 
+    if (p.bid != graph.numBlocks() && parent_->settings().prune_by_cost 
         && global_best_cost >= 0 && p.cut_size > global_best_cost) {
       // prune by cost
-      if (parent_->settings().verbose) {
-        qDebug() << "Pruned costly branch at" << p.assignment;
+      if (event_log != nullptr) {
+        event_log->log(tid_, CostPruneEvent, p.bid, p.cut_size, p.assignment);
       }
+      stats.prunes_by_depth[CostPrune][p.bid]++;
       parent_->newPrune(tid_, p.bid, p.assignment);
-    } else if (p.bid == parent_->graph().numBlocks()) {
+    } else if (p.bid == graph.numBlocks()) {
       // reached leaf, calc cost and update best
-      if (parent_->settings().verbose) {
-        qDebug() << "Leaf reached with cost" << p.cut_size << p.assignment;
+      if (event_log != nullptr) {
+        event_log->log(tid_, LeafEvent, p.bid, p.cut_size, p.assignment);
       }
+      stats.visited_leaves++;
       if (p.cut_size < *local_best_cost_ || *local_best_cost_ < 0) {
         *local_best_cost_ = p.cut_size;
         *best_assignment_ = p.assignment;
@@ -346,8 +987,8 @@ void PartitionerThread::traverseProblemSpace()
       parent_->leafReachedExchange(tid_, local_best_cost_, global_best_cost);
     } else {
       // calculate next cut sizes
-      int cut_size_r = p.cut_size + sp::Chip::calcCostDelta(graph_, p.assignment, p.bid, 1, p.net_costs);
-      int cut_size_l = p.cut_size + sp::Chip::calcCostDelta(graph_, p.assignment, p.bid, 0, p.net_costs);
+      int cut_size_r = p.cut_size + sp::Chip::calcCostDelta(graph, p.assignment, p.bid, 1, p.net_costs);
+      int cut_size_l = p.cut_size + sp::Chip::calcCostDelta(graph, p.assignment, p.bid, 0, p.net_costs);
       int next_bid = p.bid;
       // repurpose p as next left branch, make a copy for right branch
       ++p.bid;
@@ -362,30 +1003,53 @@ void PartitionerThread::traverseProblemSpace()
       p.assignment[next_bid] = 0;
       ++p.part_a_count;
       problem_stack.push(p);
+      stats.expanded_nodes++;
+      stats.expanded_by_depth[next_bid]++;
+      stats.max_stack_depth = std::max(stats.max_stack_depth, problem_stack.size());
     }
 
   }
-}
-
-PartitionerBusyWrapper::PartitionerBusyWrapper(const sp::Graph &graph,
-    PSettings settings)
-{
-  settings.headless = true;
-  settings.no_dtv = true;
-  settings.no_pie = true;
-  p = new Partitioner(graph, settings);
-}
 
-PResults PartitionerBusyWrapper::runPartitioner()
-{
-  PResults results;
-  connect(p, &Partitioner::sig_packagedResults,
-      [&results](const PResults &t_results) {
-        results = t_results;
-        qDebug() << "Received results from partitioner";
-      });
+  if (perf) {
+    parent_->postHwCounters(tid_, perf->stop());
+  }
+  qint64 cpu_end = threadCpuTime();
+  parent_->postCpuTime(tid_, (cpu_start >= 0 && cpu_end >= 0)
+      ? cpu_end - cpu_start : -1);
+  if (AllocAccounting::enabled()) {
+    AllocCounts allocs_end = AllocAccounting::threadCounts(AllocAccounting::Search);
+    parent_->postAllocCounts(tid_, allocs_end - allocs_start,
+        steady ? allocs_end - allocs_steady_start : AllocCounts(),
+        steady ? stats.expanded_nodes - steady_start_nodes : 0);
+  }
+  parent_->accountNodes(tid_, unaccounted_nodes, false);
+  parent_->postSearchStats(tid_, stats);
+  estimator.update(stats);
+  parent_->postRemainingWork(tid_, estimator.remainingNodes(problem_stack));
+  if (trace != nullptr) {
+    if (subtree_start >= 0) {
+      trace->span(tid_, "subproblem", subtree_start);
+    }
+    trace->span(tid_, "search", search_start);
+  }
 
-  p->runPartitioner();
+  // nodes left behind by an early stop bound the optimum from below, except
+  // for those that would have been pruned for imbalance or mirroring
+  int remaining_bound = -1;
+  for (const ProblemNodeParams &p : problem_stack) {
+    if (p.part_a_count > parent_->maxBlocksInPart()
+        || p.part_b_count > parent_->maxBlocksInPart()
+        || (parent_->settings().prune_half && p.bid==1 && p.assignment[0]==1)) {
+      continue;
+    }
+    int cut_size = (p.cut_size >= 0) ? p.cut_size 
+      : sp::Chip::calcCost(graph, p.assignment);
+    if (remaining_bound < 0 || cut_size < remaining_bound) {
+      remaining_bound = cut_size;
+    }
+  }
+  parent_->postRemainingBound(tid_, remaining_bound);
 
-  return results;
+  // hand over whatever is left for the final checkpoint
+  parent_->postCheckpointState(tid_, -1, problem_stack);
 }
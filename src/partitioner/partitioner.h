@@ -12,12 +12,20 @@
 #include <QObject>
 #include <random>
 #include <condition_variable>
+#include <atomic>
+#include <numeric>
 #include "spatial.h"
+#include "partitioner/trace.h"
+#include "partitioner/hwcounters.h"
+#include "partitioner/alloccount.h"
+#include "partitioner/telemetry.h"
+#include "partitioner/eventlog.h"
 
 namespace pt {
 
   // forward declarations
   class Partitioner;
+  struct Checkpoint;
 
   /* \brief Settings for the partitioner
    */
@@ -26,6 +34,7 @@ namespace pt {
     // runtime settings
     int threads=1;            //!< CPU threads to use, must be 2^N.
     int gui_update_batch=100; //!< Update GUI each time this number of prune branches have been stored
+    bool renumber_nets=true;  //!< Renumber nets of submitted jobs for memory locality, block IDs are unaffected
 
     // pruning settings
     bool prune_half=true;     //!< Prune half of the tree (since it's mirrored)
@@ -35,18 +44,148 @@ namespace pt {
     bool no_dtv=false;        //!< No decision tree view
     bool no_pie=false;        //!< No pie chart view
     bool headless=false;      //!< Running in headless mode
-    bool verbose=false;       //!< Print diagnostics
+    bool verbose=false;       //!< Print diagnostics and log search events
     bool sanity_check=false;  //!< Run sanity checks
+
+    // checkpointing
+    QString checkpoint_path;      //!< Write periodic checkpoints here if set
+    int checkpoint_interval=600;  //!< Seconds between checkpoints
+    QString resume_path;          //!< Resume from this checkpoint if set
+
+    // search budgets
+    qint64 time_limit=-1;     //!< Stop after this many ms of wall time if non-negative
+    quint64 node_limit=0;     //!< Stop after processing this many nodes if positive
+
+    // known solutions
+    QVector<int> incumbent;   //!< Start with this assignment as the best known if set
+    QString cache_dir;        //!< Persistent result cache directory if set
+    int known_lower_bound=-1; //!< Valid lower bound on the optimum, stop once it is reached if set
+
+    // diagnostics
+    QString trace_path;       //!< Write a Chrome trace of worker activity here if set
+    bool hw_counters=false;   //!< Count hardware events of each worker if the platform allows
+    QString log_path;         //!< Write verbose search events here, as text to stderr if unset
+    bool log_text=false;      //!< Write search events as text rather than binary records
+    QString log_limits;       //!< Search event sampling and rate limits, see EventLog::parseLimits
+  };
+
+  //! Reasons for the search to stop before the search space is exhausted.
+  enum StopReason{Completed, TimeLimit, NodeLimit, Cancelled, BoundReached};
+
+  //! Reasons for a branch to be pruned.
+  enum PruneReason{ImbalancePrune, MirrorPrune, CostPrune, NumPruneReasons};
+
+  /* \brief Detailed search statistics
+   *
+   * Each worker collects its own statistics without sharing and posts 
+   * snapshots to the partitioner. Depths are counted in assigned blocks.
+   */
+  struct SearchStats
+  {
+    quint64 expanded_nodes=0;   //!< Nodes branched into two children.
+    quint64 visited_leaves=0;   //!< Leaves reached.
+    int max_stack_depth=0;      //!< Largest count of pending nodes.
+    QVector<quint64> prunes_by_depth[NumPruneReasons];  //!< Prune counts by reason and depth.
+    QVector<quint64> expanded_by_depth; //!< Expanded node counts by depth.
+
+    //! Size the depth histograms for the given block count.
+    void init(int n_blocks);
+
+    //! Return the prune count for the given reason.
+    quint64 prunes(PruneReason reason) const;
+
+    //! Return the prune count over all reasons.
+    quint64 totalPrunes() const;
+
+    //! Accumulate the statistics of another worker.
+    void merge(const SearchStats &other);
+
+    /*! \brief Copy another's statistics into this one's histograms.
+     *
+     * Unlike assignment the histograms aren't shared afterwards, so neither
+     * side reallocates them on its next increment.
+     */
+    void copyFrom(const SearchStats &other);
   };
 
   /* \brief Key results from the partitioner
    */
   struct PResults
   {
-    int best_cut_size;
-    quint64 visited_leaves;
-    quint64 pruned_leaves;
-    qint64 wall_time;
+    int best_cut_size=-1;
+    QVector<int> best_assignment;
+    quint64 visited_leaves=0;
+    double pruned_leaves=0;     //!< Pruned leaves, a double since trees can exceed 2^64 leaves.
+    quint64 nodes=0;            //!< Decision tree nodes processed.
+    qint64 wall_time=0;
+    qint64 cpu_time=0;          //!< CPU time used by the workers during the search in ms, -1 if unknown.
+    int threads=0;              //!< Worker threads spawned.
+    int split_depth=0;          //!< Blocks pre-assigned to split the tree, -1 when resumed.
+    QVector<quint64> thread_nodes;          //!< Nodes processed by each thread.
+    QVector<quint64> thread_visited_leaves; //!< Leaves visited by each thread.
+    QVector<double> thread_pruned_leaves;   //!< Leaves pruned by each thread.
+    SearchStats stats;                      //!< Search statistics over all threads.
+    QVector<SearchStats> thread_stats;      //!< Search statistics of each thread.
+    HwCounters hw;                          //!< Hardware counters over all threads if counted.
+    QVector<HwCounters> thread_hw;          //!< Hardware counters of each thread if counted.
+    AllocCounts search_allocs;              //!< Heap activity of the workers if accounted.
+    QVector<AllocCounts> thread_allocs;     //!< Heap activity of each worker if accounted.
+    AllocCounts steady_allocs;              //!< Heap activity after each worker's first budget check.
+    quint64 steady_nodes=0;                 //!< Nodes expanded after each worker's first budget check.
+    AllocCounts gui_allocs;                 //!< Heap activity of GUI emits if accounted.
+    StopReason stop_reason=Completed;
+    bool proven_optimal=false;  //!< Whether best_cut_size is proven optimal.
+    int lower_bound=-1;         //!< Best lower bound on the optimal cut size.
+    double gap=-1;              //!< Relative gap between best cut and lower bound, -1 if unknown.
+    double fraction_done=-1;    //!< Estimated fraction of the search done, 1 if completed, -1 if unknown.
+    qint64 eta=-1;              //!< Estimated further ms to complete a stopped search, -1 if unknown.
+    bool cached=false;          //!< Whether the results came from the result cache.
+  };
+
+  /* \brief Progress snapshot of a running search
+   */
+  struct PProgress
+  {
+    //! States of a partitioning job.
+    enum State{Queued, Running, Finished};
+
+    State state=Queued;         //!< Job state.
+    quint64 nodes=0;            //!< Decision tree nodes processed so far.
+    quint64 visited_leaves=0;   //!< Leaves visited so far.
+    double pruned_leaves=0;     //!< Leaves pruned so far.
+    int best_cut_size=-1;       //!< Best cut found so far, -1 if none.
+    qint64 elapsed=0;           //!< Wall time since the search started in ms.
+    double fraction_done=-1;    //!< Estimated fraction of the search done, -1 if unknown.
+    qint64 eta=-1;              //!< Estimated ms until the search completes, -1 if unknown.
+  };
+
+  //! Parameters for a node in the decision tree.
+  class ProblemNodeParams
+  {
+  public:
+    //! Empty constructor.
+    ProblemNodeParams() {};
+
+    //! Construct with provided values.
+    ProblemNodeParams(const QVector<int> &assignment, int bid, 
+        quint64 part_a_count, quint64 part_b_count, const QVector<int> &net_costs)
+      : assignment(assignment), bid(bid), part_a_count(part_a_count),
+        part_b_count(part_b_count), net_costs(net_costs), cut_size(-1) {};
+
+    /*! \brief Construct a node from an assigned prefix.
+     *
+     * Blocks before bid must be assigned, partition counts are derived from 
+     * them. The cut size is left uncalculated.
+     */
+    static ProblemNodeParams fromPrefix(const QVector<int> &assignment, int bid,
+        const QVector<int> &net_costs);
+
+    QVector<int> assignment;
+    int bid;
+    quint64 part_a_count;
+    quint64 part_b_count;
+    QVector<int> net_costs;
+    int cut_size;
   };
 
   /*! \brief Partitioning algorithm class.
@@ -60,9 +199,10 @@ namespace pt {
   public:
     /*! \brief Contructor.
      *
-     * Constructor taking the problem.
+     * Constructor taking the problem. The graph is searched as given, nets 
+     * are renumbered where graphs are frozen (see JobRunner::submit()).
      */
-    Partitioner(const sp::Graph &graph, const PSettings &settings=PSettings());
+    Partitioner(sp::GraphPtr graph, const PSettings &settings=PSettings());
 
     //! Destructor.
     ~Partitioner();
@@ -70,37 +210,110 @@ namespace pt {
     //! Run the partitioner.
     void runPartitioner();
 
+    /*! \brief Ask all workers to stop as soon as possible.
+     *
+     * The best solution found so far is reported along with the lower bound 
+     * over the unexplored nodes. Safe to call from any thread.
+     */
+    void cancel() {requestStop(Cancelled);}
+
+    //! Return whether workers have been asked to stop.
+    bool stopRequested() const {return stop_reason_.load(std::memory_order_relaxed) != Completed;}
+
+    /*! \brief Account for nodes processed by a worker and enforce budgets.
+     *
+     * Workers call this in batches rather than for every node. Returns false 
+     * if the search should stop.
+     */
+    bool accountNodes(int tid, quint64 n, bool enforce_budgets=true);
+
+    //! Number of nodes workers process between budget checks.
+    quint64 budgetCheckInterval() const {return budget_check_interval_;}
+
+    //! Post a snapshot of a worker's search statistics.
+    void postSearchStats(int tid, const SearchStats &stats);
+
+    //! Post a worker's hardware counters once its search is done.
+    void postHwCounters(int tid, const HwCounters &counters);
+
+    /*! \brief Post a worker's heap activity once its search is done.
+     *
+     * The steady state starts at the worker's first budget check, steady_nodes
+     * are the nodes expanded since then.
+     */
+    void postAllocCounts(int tid, const AllocCounts &search,
+        const AllocCounts &steady, quint64 steady_nodes);
+
+    //! Return the search statistics over all workers, safe to call from any thread.
+    SearchStats searchStats() const;
+
+    //! Record a worker's estimate of the nodes left under its stack.
+    void postRemainingWork(int tid, double nodes) {telem_.setRemainingNodes(tid, nodes);}
+
+    //! Record the lower bound over the nodes left unexplored by a worker.
+    void postRemainingBound(int tid, int bound) {remaining_bounds_[tid] = bound;}
+
+    //! Record the CPU time a worker used for its search in ms, -1 if unknown.
+    void postCpuTime(int tid, qint64 cpu_time) {thread_cpu_time_[tid] = cpu_time;}
+
+    //! Return the results of the last completed run.
+    const PResults &results() const {return results_;}
+
+    //! Return a progress snapshot, safe to call from any thread.
+    PProgress progress() const;
+
     //! Inform partitioner of new pruned branches
     void newPrune(int tid, int bid, const QVector<int> &assignments);
 
     //! Information exchange at leaf node.
     void leafReachedExchange(int tid, int *local_best_cost, int &global_best_cost);
 
-    //! Return the best cost.
-    int bestCost() {return best_cost_;}
+    //! Return the best cost over all workers, safe to call from any thread.
+    int bestCost() const {return telem_.bestCost();}
 
-    //! Set a new best cost.
-    void setBestCost(int c) {best_cost_ = c;}
+    //! Return the search counters, safe to call from any thread.
+    TelemetrySnapshot telemetry() const;
 
     //! Return the current graph.
-    const sp::Graph &graph() {return graph_;}
+    const sp::Graph &graph() const {return *graph_;}
 
     //! Return the current settings.
     const PSettings &settings() {return settings_;}
 
+    //! Return the trace recorder, null unless tracing.
+    TraceRecorder *trace() const {return trace_;}
+
+    //! Return the search event log, null unless verbose.
+    EventLog *eventLog() const {return event_log_;}
+
     //! Return the maximum blocks allowed in partition.
     quint64 maxBlocksInPart() {return max_blocks_in_part_;}
 
+    //! Return the current checkpoint generation, polled by worker threads.
+    int checkpointGeneration() const {return ckpt_gen_.load(std::memory_order_relaxed);}
+
+    /*! \brief Post a worker's state for the requested checkpoint generation.
+     *
+     * Called by the worker thread itself so that the pending stack, incumbent 
+     * and counters are captured consistently without stopping the search.
+     * Finished workers post with gen -1 and an empty stack.
+     */
+    void postCheckpointState(int tid, int gen, const QStack<ProblemNodeParams> &stack);
+
   signals:
 
     //! Signal to inform of new prunes to be visualized.
     void sig_pruned(QQueue<QPair<int,QVector<int>>> *bid_as_pairs);
 
-    //! Signal to show updated telemetry information.
-    void sig_updateTelem(quint64 visited, quint64 pruned, int best_cut);
+    //! Signal to show updated telemetry information, estimates are -1 if unknown.
+    void sig_updateTelem(quint64 visited, double pruned, int best_cut,
+        double fraction_done, qint64 eta);
+
+    //! Signal to show updated search statistics and per-thread node counts.
+    void sig_updateStats(const pt::SearchStats &stats, const QVector<quint64> &thread_nodes);
 
     //! Emit the best partition.
-    void sig_bestPart(sp::Graph *graph, const QVector<int> block_part, qint64 elapsed_time);
+    void sig_bestPart(sp::GraphPtr graph, const QVector<int> block_part, qint64 elapsed_time);
 
     //! Emit packaged results mainly for benchmarking.
     void sig_packagedResults(PResults results);
@@ -116,53 +329,81 @@ namespace pt {
     //! Emit pruned branches for GUI update. Doesn't do so if no_gui is set in settings.
     void emitPrunedBranches(bool emit_all=false);
 
-    //! Return the accumulated pruned leaf count.
-    quint64 prunedLeafCount() {return std::accumulate(pruned_leaves_.cbegin(), pruned_leaves_.cend(), 0L);}
+    /*! \brief Build the initial frontier for each thread to be spawned.
+     *
+     * The frontier either comes from splitting a fresh tree or from the 
+     * checkpoint to resume from. The size of the returned list determines the 
+     * thread count.
+     */
+    QVector<QVector<ProblemNodeParams>> initialFrontier();
+
+    //! Request or write out checkpoints when due. Called periodically.
+    void checkpointTick();
 
-    //! Return the accumulated visited leaf count.
-    quint64 visitedLeafCount() {return std::accumulate(visited_leaves_.cbegin(), visited_leaves_.cend(), 0L);}
+    //! Assemble a checkpoint from worker states, false if some are not posted.
+    bool collectCheckpoint(Checkpoint &ckpt);
+
+    //! Ask workers to stop for the given reason, the first reason is kept.
+    void requestStop(StopReason reason);
 
     // variables
-    sp::Graph graph_;         //!< Graph containing the problem.
+    sp::GraphPtr graph_;      //!< Graph containing the problem, shared with workers.
     PSettings settings_;      //!< Partitioner settings.
-    int best_cost_;           //!< Known best cost so far.
     QVector<int> best_costs_; //!< Best costs from all threads.
     QVector<QVector<int>> best_assignments_;  //!< Best asssignments from all threads.
     quint64 max_blocks_in_part_;  //!< Maximum count of blocks in partition.
-    QVector<quint64> visited_leaves_; //!< Keep track of the visited node count.
-    QVector<quint64> pruned_leaves_;  //!< Keep track of the pruned node count.
     QVector<QQueue<QPair<int,QVector<int>>>> bid_assignment_pairs_;
+    int init_best_cost_=-1;           //!< Incumbent cost to start with.
+    QVector<int> init_best_assignment_; //!< Incumbent assignment to start with.
+    quint64 init_visited_=0;          //!< Visited leaves carried over from a resume.
+    double init_pruned_=0;            //!< Pruned leaves carried over from a resume.
 
     // multi-threaded programming
+    std::atomic<bool> telem_ready_; //!< Whether per-thread records have been set up.
     QElapsedTimer wall_timer_;  //!< Keep track of wall time.
     quint64 actual_th_count_;   //!< Count of actual threads spawned.
     int split_at_bid_;
     QList<QThread*> threads;
-    int remaining_th_;
+    std::atomic<int> remaining_th_; //!< Threads yet to complete, read by progress().
     QVector<QMutex*> prune_mutex_;
     QMutex complete_mutex_;
     QTimer *gui_update_timer_;
-  };
 
-  //! Parameters for a node in the decision tree.
-  class ProblemNodeParams
-  {
-  public:
-    //! Empty constructor.
-    ProblemNodeParams() {};
-
-    //! Construct with provided values.
-    ProblemNodeParams(const QVector<int> &assignment, int bid, 
-        quint64 part_a_count, quint64 part_b_count, const QVector<int> &net_costs)
-      : assignment(assignment), bid(bid), part_a_count(part_a_count),
-        part_b_count(part_b_count), net_costs(net_costs), cut_size(-1) {};
-
-    QVector<int> assignment;
-    int bid;
-    quint64 part_a_count;
-    quint64 part_b_count;
-    QVector<int> net_costs;
-    int cut_size;
+    // checkpointing
+    std::atomic<int> ckpt_gen_;       //!< Latest requested checkpoint generation.
+    bool ckpt_pending_=false;         //!< Whether a requested checkpoint awaits workers.
+    QElapsedTimer ckpt_timer_;        //!< Time since the last checkpoint.
+    QMutex ckpt_mutex_;               //!< Guards the posted worker states below.
+    QVector<int> ckpt_posted_gen_;    //!< Generation last posted by each worker.
+    QVector<QVector<ProblemNodeParams>> ckpt_stacks_; //!< Posted worker stacks.
+    QVector<int> ckpt_best_costs_;    //!< Posted worker incumbent costs.
+    QVector<QVector<int>> ckpt_best_assignments_;   //!< Posted worker incumbents.
+    QVector<quint64> ckpt_visited_;   //!< Posted worker visited leaf counts.
+    QVector<double> ckpt_pruned_;     //!< Posted worker pruned leaf counts.
+
+    // search budgets and results
+    std::atomic<int> stop_reason_;    //!< StopReason, Completed while running.
+    Telemetry telem_;                 //!< Node and leaf counters and the best cost.
+    QVector<qint64> thread_cpu_time_; //!< Posted worker CPU times in ms.
+    quint64 budget_check_interval_;   //!< Nodes between budget checks.
+    QVector<int> remaining_bounds_;   //!< Lower bounds over unexplored nodes per thread.
+    QVector<SearchStats> thread_stats_;   //!< Posted search statistics per thread.
+    QVector<QMutex*> stats_mutex_;    //!< Guards each thread's posted statistics.
+    QVector<HwCounters> thread_hw_;   //!< Posted hardware counters per thread.
+    QVector<AllocCounts> thread_allocs_;        //!< Posted heap activity per thread.
+    QVector<AllocCounts> thread_steady_allocs_; //!< Posted steady state heap activity per thread.
+    QVector<quint64> thread_steady_nodes_;      //!< Posted steady state node counts per thread.
+    AllocCounts gui_allocs_start_;    //!< GUI emit heap activity when the search started.
+    PResults results_;                //!< Results of the last completed run.
+
+    // tracing
+    TraceRecorder *trace_=nullptr;    //!< Trace recorder, null unless tracing.
+    int main_slot_=0;                 //!< Trace slot of the thread running the partitioner.
+    qint64 last_gui_update_=-1;       //!< Trace time of the last GUI update.
+    qint64 gui_update_interval_=0;    //!< GUI update timer interval in ms.
+
+    // verbose logging
+    EventLog *event_log_=nullptr;     //!< Search event log, null unless verbose.
   };
 
   class PartitionerThread : public QThread
@@ -170,8 +411,8 @@ namespace pt {
     Q_OBJECT
   public:
     //! Construct a partitioner thread.
-    PartitionerThread(int tid, const sp::Graph &graph, PSettings settings,
-        QVector<int> curr_assignment, int start_bid, QVector<int> *best_assignment,
+    PartitionerThread(int tid, sp::GraphPtr graph, PSettings settings,
+        const QVector<ProblemNodeParams> &init_nodes, QVector<int> *best_assignment,
         int *local_best_cost, Partitioner *parent);
 
     //! Run the partitioner.
@@ -183,33 +424,16 @@ namespace pt {
   private:
 
     int tid_;               //!< Thread ID.
-    sp::Graph graph_;       //!< Graph containing the problem.
+    sp::GraphPtr graph_;    //!< Graph containing the problem, shared read-only.
     PSettings settings_;    //!< Partitioner settings.
-    QVector<int> init_assignment_;  //!< Initial assignments.
-    int start_bid_;         //!< Starting block ID
+    QVector<ProblemNodeParams> init_nodes_; //!< Initial nodes, the last is explored first.
     QVector<int> *best_assignment_; //!< Pointer to best assignment so far.
     int *local_best_cost_;        //!< Pointer to best cost so far.
     Partitioner *parent_;
   };
 
-  //! A wrapper class for running Partitioner with a busy wait.
-  class PartitionerBusyWrapper : public QObject
-  {
-  Q_OBJECT
-
-  public:
-    //! Constructor. Settings will be altered for headless operation.
-    PartitionerBusyWrapper(const sp::Graph &graph, 
-        PSettings settings=PSettings());
-
-    //! Run.
-    PResults runPartitioner();
-
-  private:
-
-    Partitioner *p; //!< The partitioner.
-  };
-
 }
 
+Q_DECLARE_METATYPE(pt::PResults)
+
 #endif
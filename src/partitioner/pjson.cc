@@ -0,0 +1,222 @@
+/*!
+  \file pjson.cc
+  \author Samuel Ng
+  \date 2021-03-24 created
+  \copyright GNU LGPL v3
+  */
+
+#include "pjson.h"
+
+using namespace pt;
+
+PSettings PJson::settingsFromJson(const QJsonObject &obj, const PSettings &base)
+{
+  PSettings settings = base;
+  settings.threads = obj.value("threads").toInt(settings.threads);
+  settings.gui_update_batch = obj.value("gui_update_batch").toInt(settings.gui_update_batch);
+  settings.renumber_nets = obj.value("renumber_nets").toBool(settings.renumber_nets);
+  settings.prune_half = obj.value("prune_half").toBool(settings.prune_half);
+  settings.prune_by_cost = obj.value("prune_by_cost").toBool(settings.prune_by_cost);
+  settings.verbose = obj.value("verbose").toBool(settings.verbose);
+  settings.sanity_check = obj.value("sanity_check").toBool(settings.sanity_check);
+  settings.checkpoint_path = obj.value("checkpoint_path").toString(settings.checkpoint_path);
+  settings.checkpoint_interval = obj.value("checkpoint_interval").toInt(settings.checkpoint_interval);
+  settings.resume_path = obj.value("resume_path").toString(settings.resume_path);
+  settings.time_limit = (qint64)obj.value("time_limit").toDouble(settings.time_limit);
+  settings.node_limit = (quint64)obj.value("node_limit").toDouble(settings.node_limit);
+  settings.cache_dir = obj.value("cache_dir").toString(settings.cache_dir);
+  settings.known_lower_bound = obj.value("known_lower_bound").toInt(settings.known_lower_bound);
+  settings.trace_path = obj.value("trace_path").toString(settings.trace_path);
+  settings.hw_counters = obj.value("hw_counters").toBool(settings.hw_counters);
+  settings.log_path = obj.value("log_path").toString(settings.log_path);
+  settings.log_text = obj.value("log_text").toBool(settings.log_text);
+  settings.log_limits = obj.value("log_limits").toString(settings.log_limits);
+  return settings;
+}
+
+QJsonObject PJson::settingsToJson(const PSettings &settings)
+{
+  QJsonObject obj;
+  obj["threads"] = settings.threads;
+  obj["gui_update_batch"] = settings.gui_update_batch;
+  obj["renumber_nets"] = settings.renumber_nets;
+  obj["prune_half"] = settings.prune_half;
+  obj["prune_by_cost"] = settings.prune_by_cost;
+  obj["verbose"] = settings.verbose;
+  obj["sanity_check"] = settings.sanity_check;
+  obj["checkpoint_path"] = settings.checkpoint_path;
+  obj["checkpoint_interval"] = settings.checkpoint_interval;
+  obj["resume_path"] = settings.resume_path;
+  obj["time_limit"] = (double)settings.time_limit;
+  obj["node_limit"] = (double)settings.node_limit;
+  obj["cache_dir"] = settings.cache_dir;
+  obj["known_lower_bound"] = settings.known_lower_bound;
+  obj["trace_path"] = settings.trace_path;
+  obj["hw_counters"] = settings.hw_counters;
+  obj["log_path"] = settings.log_path;
+  obj["log_text"] = settings.log_text;
+  obj["log_limits"] = settings.log_limits;
+  return obj;
+}
+
+QJsonObject PJson::resultsToJson(const PResults &results)
+{
+  QJsonObject obj;
+  QJsonArray assignment;
+  for (int part : results.best_assignment) {
+    assignment.append(part);
+  }
+  obj["best_cut_size"] = results.best_cut_size;
+  obj["assignment"] = assignment;
+  obj["proven_optimal"] = results.proven_optimal;
+  obj["lower_bound"] = results.lower_bound;
+  obj["gap"] = results.gap;
+  obj["fraction_done"] = results.fraction_done;
+  obj["eta"] = (double)results.eta;
+  obj["stop_reason"] = stopReasonName(results.stop_reason);
+  obj["cached"] = results.cached;
+  obj["wall_time"] = (double)results.wall_time;
+  obj["cpu_time"] = (double)results.cpu_time;
+  obj["threads"] = results.threads;
+  obj["split_depth"] = results.split_depth;
+  obj["nodes"] = (double)results.nodes;
+  obj["visited_leaves"] = (double)results.visited_leaves;
+  obj["pruned_leaves"] = results.pruned_leaves;
+  QJsonArray per_thread;
+  for (int tid=0; tid<results.thread_nodes.size(); tid++) {
+    QJsonObject th;
+    th["nodes"] = (double)results.thread_nodes[tid];
+    th["visited_leaves"] = (double)results.thread_visited_leaves.value(tid);
+    th["pruned_leaves"] = results.thread_pruned_leaves.value(tid);
+    if (tid < results.thread_stats.size()) {
+      th["stats"] = statsToJson(results.thread_stats[tid]);
+    }
+    if (tid < results.thread_hw.size() && results.thread_hw[tid].isValid()) {
+      th["hw_counters"] = hwCountersToJson(results.thread_hw[tid],
+          results.thread_stats.value(tid).expanded_nodes);
+    }
+    if (tid < results.thread_allocs.size()) {
+      th["allocs"] = allocsToJson(results.thread_allocs[tid],
+          results.thread_stats.value(tid).expanded_nodes);
+    }
+    per_thread.append(th);
+  }
+  obj["per_thread"] = per_thread;
+  obj["stats"] = statsToJson(results.stats);
+  if (results.hw.isValid()) {
+    obj["hw_counters"] = hwCountersToJson(results.hw, results.stats.expanded_nodes);
+  }
+  if (AllocAccounting::enabled()) {
+    QJsonObject allocs;
+    allocs["search"] = allocsToJson(results.search_allocs, results.stats.expanded_nodes);
+    allocs["steady_state"] = allocsToJson(results.steady_allocs, results.steady_nodes);
+    allocs["gui_emit"] = allocsToJson(results.gui_allocs, results.stats.expanded_nodes);
+    obj["allocs"] = allocs;
+  }
+  return obj;
+}
+
+QJsonObject PJson::statsToJson(const SearchStats &stats)
+{
+  static const char *reason_names[NumPruneReasons] = {"imbalance", "mirror",
+    "cost"};
+  QJsonObject prunes, prunes_by_depth;
+  for (int reason=0; reason<NumPruneReasons; reason++) {
+    QJsonArray hist;
+    for (quint64 count : stats.prunes_by_depth[reason]) {
+      hist.append((double)count);
+    }
+    prunes[reason_names[reason]] = (double)stats.prunes((PruneReason)reason);
+    prunes_by_depth[reason_names[reason]] = hist;
+  }
+  QJsonObject obj;
+  obj["expanded_nodes"] = (double)stats.expanded_nodes;
+  obj["visited_leaves"] = (double)stats.visited_leaves;
+  obj["max_stack_depth"] = stats.max_stack_depth;
+  QJsonArray expanded_by_depth;
+  for (quint64 count : stats.expanded_by_depth) {
+    expanded_by_depth.append((double)count);
+  }
+  obj["expanded_by_depth"] = expanded_by_depth;
+  obj["prunes"] = prunes;
+  obj["prunes_by_depth"] = prunes_by_depth;
+  return obj;
+}
+
+QJsonObject PJson::hwCountersToJson(const HwCounters &hw, quint64 expanded_nodes)
+{
+  QJsonObject obj;
+  for (int ev=0; ev<HwCounters::NumEvents; ev++) {
+    if (hw.available((HwCounters::Event)ev)) {
+      obj[HwCounters::eventName((HwCounters::Event)ev)] = (double)hw.values[ev];
+    }
+  }
+  if (hw.ipc() >= 0) {
+    obj["ipc"] = hw.ipc();
+  }
+  for (HwCounters::Event ev : {HwCounters::Instructions, HwCounters::Cycles,
+      HwCounters::CacheMisses, HwCounters::BranchMisses}) {
+    if (hw.perNode(ev, expanded_nodes) >= 0) {
+      obj[QString("%1_per_node").arg(HwCounters::eventName(ev))] =
+        hw.perNode(ev, expanded_nodes);
+    }
+  }
+  return obj;
+}
+
+QJsonObject PJson::allocsToJson(const AllocCounts &counts, quint64 nodes)
+{
+  QJsonObject obj;
+  obj["allocs"] = (double)counts.allocs;
+  obj["frees"] = (double)counts.frees;
+  obj["bytes"] = (double)counts.bytes;
+  obj["nodes"] = (double)nodes;
+  obj["allocs_per_node"] = counts.perNode(nodes);
+  return obj;
+}
+
+QJsonObject PJson::runToJson(const QString &in_path, const sp::Graph &graph,
+    const PSettings &settings, const PResults &results)
+{
+  QJsonObject graph_obj;
+  graph_obj["num_blocks"] = graph.numBlocks();
+  graph_obj["num_nets"] = graph.numNets();
+  graph_obj["num_pins"] = graph.numPins();
+  graph_obj["hash"] = QString::fromLatin1(graph.canonicalHash().toHex());
+
+  QJsonObject obj;
+  obj["schema"] = QString("partitioner-run");
+  obj["schema_version"] = run_schema_version;
+  obj["input"] = in_path;
+  obj["graph"] = graph_obj;
+  obj["settings"] = settingsToJson(settings);
+  obj["results"] = resultsToJson(results);
+  return obj;
+}
+
+QJsonObject PJson::progressToJson(const PProgress &progress)
+{
+  static const char *state_names[] = {"queued", "running", "finished"};
+  QJsonObject obj;
+  obj["state"] = state_names[progress.state];
+  obj["nodes"] = (double)progress.nodes;
+  obj["visited_leaves"] = (double)progress.visited_leaves;
+  obj["pruned_leaves"] = (double)progress.pruned_leaves;
+  obj["best_cut_size"] = progress.best_cut_size;
+  obj["elapsed"] = (double)progress.elapsed;
+  obj["fraction_done"] = progress.fraction_done;
+  obj["eta"] = (double)progress.eta;
+  return obj;
+}
+
+QString PJson::stopReasonName(StopReason reason)
+{
+  switch (reason) {
+    case Completed: return "completed";
+    case TimeLimit: return "time_limit";
+    case NodeLimit: return "node_limit";
+    case Cancelled: return "cancelled";
+    case BoundReached: return "bound_reached";
+  }
+  return "unknown";
+}
@@ -0,0 +1,76 @@
+/*!
+  \file pjson.h
+  \brief JSON conversions of partitioner settings, progress and results.
+  \author Samuel Ng
+  \date 2021-03-24 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_PJSON_H_
+#define _PT_PJSON_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  //! Conversions between partitioner structures and JSON objects.
+  class PJson
+  {
+  public:
+    /*! \brief Read settings from a JSON object.
+     *
+     * Keys use the same names as the PSettings members. Keys that are absent
+     * keep the values of the provided base settings.
+     */
+    static PSettings settingsFromJson(const QJsonObject &obj,
+        const PSettings &base=PSettings());
+
+    //! Write settings to a JSON object.
+    static QJsonObject settingsToJson(const PSettings &settings);
+
+    //! Write results to a JSON object.
+    static QJsonObject resultsToJson(const PResults &results);
+
+    /*! \brief Write search statistics to a JSON object.
+     *
+     * Prune counts are keyed by reason, "prunes_by_depth" holds one array per
+     * reason indexed by the count of assigned blocks.
+     */
+    static QJsonObject statsToJson(const SearchStats &stats);
+
+    /*! \brief Write hardware counters to a JSON object.
+     *
+     * Counted events are keyed by name, along with "ipc" and the per node 
+     * rates "instructions_per_node", "cycles_per_node", "cache_misses_per_node"
+     * and "branch_misses_per_node" over the given expanded node count. Events
+     * that weren't counted are left out.
+     */
+    static QJsonObject hwCountersToJson(const HwCounters &hw, quint64 expanded_nodes);
+
+    //! Write heap activity to a JSON object, with "allocs_per_node" over the given nodes.
+    static QJsonObject allocsToJson(const AllocCounts &counts, quint64 nodes);
+
+    //! Version of the run report schema, bumped on incompatible changes.
+    static const int run_schema_version = 1;
+
+    /*! \brief Write a complete report of a headless run.
+     *
+     * The report holds "schema" and "schema_version" keys identifying the 
+     * format, the "input" path, a "graph" summary, the "settings" used and 
+     * the "results" including per-thread counters. Keys are only ever added 
+     * within a schema version.
+     */
+    static QJsonObject runToJson(const QString &in_path, const sp::Graph &graph,
+        const PSettings &settings, const PResults &results);
+
+    //! Write a progress snapshot to a JSON object.
+    static QJsonObject progressToJson(const PProgress &progress);
+
+    //! Return the name of a stop reason.
+    static QString stopReasonName(StopReason reason);
+  };
+
+}
+
+#endif
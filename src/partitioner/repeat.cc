@@ -0,0 +1,95 @@
+/*!
+  \file repeat.cc
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#include "repeat.h"
+#include "jobs.h"
+#include "pjson.h"
+
+using namespace pt;
+
+constexpr double RepeatRunner::max_reliable_cv;
+
+
+// RepeatReport implementation
+
+QJsonObject RepeatReport::toJson() const
+{
+  QJsonArray run_arr;
+  for (const PResults &results : runs) {
+    QJsonObject obj;
+    obj["wall_time"] = (double)results.wall_time;
+    obj["cpu_time"] = (double)results.cpu_time;
+    obj["nodes"] = (double)results.nodes;
+    obj["best_cut_size"] = results.best_cut_size;
+    obj["stop_reason"] = PJson::stopReasonName(results.stop_reason);
+    run_arr.append(obj);
+  }
+  QJsonObject obj;
+  obj["repeats"] = runs.size();
+  obj["warmup"] = warmup;
+  obj["wall_time"] = wall_time.toJson();
+  obj["node_rate"] = node_rate.toJson();
+  obj["reliable"] = isReliable();
+  obj["warnings"] = QJsonArray::fromStringList(warnings);
+  obj["runs"] = run_arr;
+  return obj;
+}
+
+
+// RepeatRunner implementation
+
+RepeatRunner::RepeatRunner(sp::GraphPtr graph, const PSettings &settings)
+  : graph_(graph), settings_(settings)
+{
+  if (!settings_.cache_dir.isEmpty()) {
+    qWarning() << "The result cache is not used for repeated runs.";
+    settings_.cache_dir.clear();
+  }
+}
+
+RepeatReport RepeatRunner::run(int repeats, int warmup)
+{
+  RepeatReport report;
+  report.warmup = warmup;
+  for (int i=0; i<warmup; i++) {
+    JobRunner::global()->submit(graph_, settings_).result();
+  }
+
+  QVector<double> wall_times, node_rates;
+  for (int i=0; i<repeats; i++) {
+    PResults results = JobRunner::global()->submit(graph_, settings_).result();
+    report.runs.append(results);
+    wall_times.append(results.wall_time);
+    node_rates.append(results.nodes / (qMax<qint64>(results.wall_time, 1) / 1000.));
+    if (settings_.verbose) {
+      qDebug() << QString("Run %1/%2: %3 ms, %4 nodes").arg(i+1).arg(repeats)
+        .arg(results.wall_time).arg(results.nodes);
+    }
+  }
+  report.wall_time = SampleStats::of(wall_times);
+  report.node_rate = SampleStats::of(node_rates);
+
+  // flag statistics that shouldn't be trusted
+  if (repeats < 3) {
+    report.warnings.append("fewer than 3 runs");
+  }
+  if (report.wall_time.cv() > max_reliable_cv) {
+    report.warnings.append(QString("wall time CV of %1% exceeds %2%")
+        .arg(100 * report.wall_time.cv(), 0, 'f', 1).arg(100 * max_reliable_cv));
+  }
+  if (repeats > 0 && report.wall_time.median < min_reliable_time) {
+    report.warnings.append(QString("median wall time below %1 ms")
+        .arg(min_reliable_time));
+  }
+  for (const PResults &results : report.runs) {
+    if (results.stop_reason != report.runs.first().stop_reason) {
+      report.warnings.append("runs stopped for different reasons");
+      break;
+    }
+  }
+  return report;
+}
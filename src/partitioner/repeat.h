@@ -0,0 +1,61 @@
+/*!
+  \file repeat.h
+  \brief Repeated runs of one problem with timing statistics.
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_REPEAT_H_
+#define _PT_REPEAT_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+#include "partitioner/stats.h"
+
+namespace pt {
+
+  //! Results and timing statistics of repeated runs.
+  struct RepeatReport
+  {
+    int warmup=0;               //!< Untimed runs before the measured runs.
+    QList<PResults> runs;       //!< Results of the measured runs.
+    SampleStats wall_time;      //!< Wall time in ms.
+    SampleStats node_rate;      //!< Processed nodes per second of wall time.
+    QStringList warnings;       //!< Reasons the statistics may be unreliable.
+
+    //! Return whether the statistics are reliable.
+    bool isReliable() const {return warnings.isEmpty();}
+
+    //! Write the statistics and per-run timings to a JSON object.
+    QJsonObject toJson() const;
+  };
+
+  /*! \brief Runs a problem repeatedly with a fresh Partitioner each time.
+   *
+   * Runs go through the global JobRunner one after another. The result cache
+   * is bypassed so that every run searches.
+   */
+  class RepeatRunner
+  {
+  public:
+    //! Wall time CV above which the statistics are flagged as unreliable.
+    static constexpr double max_reliable_cv = 0.05;
+
+    //! Wall time in ms below which timer resolution dominates.
+    static const qint64 min_reliable_time = 10;
+
+    //! Construct a runner for the given problem.
+    RepeatRunner(sp::GraphPtr graph, const PSettings &settings);
+
+    //! Run the warmup runs and then the measured runs.
+    RepeatReport run(int repeats, int warmup=0);
+
+  private:
+    sp::GraphPtr graph_;  //!< Problem to run.
+    PSettings settings_;  //!< Settings of every run.
+  };
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*!
+  \file resultcache.cc
+  \author Samuel Ng
+  \date 2021-03-26 created
+  \copyright GNU LGPL v3
+  */
+
+#include "resultcache.h"
+
+using namespace pt;
+
+namespace {
+
+  //! Return whether the entry holds a balanced partition of the graph with 
+  //! the recorded cut size.
+  bool entryMatchesGraph(const ResultCache::Entry &entry, const sp::Graph &graph)
+  {
+    int num_blocks = graph.numBlocks();
+    if (entry.assignment.size() != num_blocks) {
+      return false;
+    }
+    int part_a_count = 0;
+    for (int part : entry.assignment) {
+      if (part != 0 && part != 1) {
+        return false;
+      }
+      part_a_count += (part == 0) ? 1 : 0;
+    }
+    int max_blocks_in_part = (num_blocks + 1) / 2;
+    if (part_a_count > max_blocks_in_part
+        || num_blocks - part_a_count > max_blocks_in_part) {
+      return false;
+    }
+    return sp::Chip::calcCost(graph, entry.assignment) == entry.cut_size;
+  }
+
+}
+
+ResultCache::ResultCache(const QString &dir_path)
+  : dir_(dir_path)
+{
+  if (!dir_.exists() && !dir_.mkpath(".")) {
+    qWarning() << "Unable to create result cache directory" << dir_path;
+  }
+}
+
+bool ResultCache::lookup(const QByteArray &key, const sp::Graph &graph,
+    Entry &entry) const
+{
+  QFile f(entryPath(key));
+  if (!f.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  if (!doc.isObject()) {
+    qWarning() << "Ignoring corrupted result cache entry" << f.fileName();
+    return false;
+  }
+  QJsonObject obj = doc.object();
+  entry.cut_size = obj.value("cut_size").toInt(-1);
+  entry.proven_optimal = obj.value("proven_optimal").toBool(false);
+  entry.assignment.clear();
+  for (const QJsonValue &part : obj.value("assignment").toArray()) {
+    entry.assignment.append(part.toInt());
+  }
+  if (entry.cut_size < 0) {
+    return false;
+  }
+
+  // the key only identifies the graph, a stale or hand edited entry must not 
+  // be returned as a proven result or used as the incumbent
+  if (!entryMatchesGraph(entry, graph)) {
+    qWarning() << "Ignoring result cache entry inconsistent with its graph"
+      << f.fileName();
+    return false;
+  }
+  return true;
+}
+
+bool ResultCache::store(const QByteArray &key, const sp::Graph &graph,
+    const PResults &results)
+{
+  if (results.best_cut_size < 0) {
+    return false;
+  }
+  Entry existing;
+  if (lookup(key, graph, existing)) {
+    if (existing.proven_optimal
+        || (!results.proven_optimal && existing.cut_size <= results.best_cut_size)) {
+      return false;
+    }
+  }
+
+  QJsonObject obj;
+  QJsonArray assignment;
+  for (int part : results.best_assignment) {
+    assignment.append(part);
+  }
+  obj["cut_size"] = results.best_cut_size;
+  obj["proven_optimal"] = results.proven_optimal;
+  obj["assignment"] = assignment;
+
+  QSaveFile f(entryPath(key));
+  if (!f.open(QIODevice::WriteOnly)) {
+    qWarning() << "Unable to write result cache entry" << f.fileName();
+    return false;
+  }
+  f.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  return f.commit();
+}
+
+QString ResultCache::entryPath(const QByteArray &key) const
+{
+  return dir_.filePath(QString::fromLatin1(key.toHex()) + ".json");
+}
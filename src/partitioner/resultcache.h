@@ -0,0 +1,64 @@
+/*!
+  \file resultcache.h
+  \brief Persistent cache of partitioning results keyed by graph hash.
+  \author Samuel Ng
+  \date 2021-03-26 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_RESULTCACHE_H_
+#define _PT_RESULTCACHE_H_
+
+#include <QtCore>
+#include "partitioner/partitioner.h"
+
+namespace pt {
+
+  /*! \brief On-disk cache of the best known partition for each graph.
+   *
+   * Entries are keyed by sp::Graph::canonicalHash() and stored as one JSON 
+   * file per graph in the cache directory. An entry either holds a proven 
+   * optimal cut, which can be returned without searching, or the best cut 
+   * found by a search that was stopped early, which is a good starting 
+   * incumbent for the next search.
+   */
+  class ResultCache
+  {
+  public:
+    //! A cached partition.
+    struct Entry
+    {
+      int cut_size=-1;              //!< Cut size of the assignment.
+      QVector<int> assignment;      //!< Block assignment.
+      bool proven_optimal=false;    //!< Whether the cut is proven optimal.
+    };
+
+    //! Construct a cache stored in the given directory, created if needed.
+    ResultCache(const QString &dir_path);
+
+    /*! \brief Look up the entry of a graph, returns false on a miss.
+     *
+     * Entries whose assignment is not a balanced partition of the graph with 
+     * the recorded cut size are ignored with a warning and count as a miss.
+     */
+    bool lookup(const QByteArray &key, const sp::Graph &graph, Entry &entry) const;
+
+    /*! \brief Store the results of a search on the given graph.
+     *
+     * Existing entries are only replaced by proven results or by better 
+     * bounds. Returns false if the results were not stored.
+     */
+    bool store(const QByteArray &key, const sp::Graph &graph,
+        const PResults &results);
+
+  private:
+
+    //! Return the file path of the entry with the given key.
+    QString entryPath(const QByteArray &key) const;
+
+    QDir dir_;  //!< Cache directory.
+  };
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*!
+  \file stats.cc
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#include "stats.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace pt;
+
+SampleStats SampleStats::of(QVector<double> samples)
+{
+  SampleStats stats;
+  stats.count = samples.size();
+  if (samples.isEmpty()) {
+    return stats;
+  }
+  std::sort(samples.begin(), samples.end());
+  int n = samples.size();
+  stats.min = samples.first();
+  stats.max = samples.last();
+  stats.median = (n % 2 == 1) ? samples[n/2]
+    : (samples[n/2 - 1] + samples[n/2]) / 2;
+  double sum = 0;
+  for (double s : samples) {
+    sum += s;
+  }
+  stats.mean = sum / n;
+  if (n > 1) {
+    double sq_sum = 0;
+    for (double s : samples) {
+      sq_sum += (s - stats.mean) * (s - stats.mean);
+    }
+    stats.stddev = std::sqrt(sq_sum / (n - 1));
+  }
+  return stats;
+}
+
+QJsonObject SampleStats::toJson() const
+{
+  QJsonObject obj;
+  obj["count"] = count;
+  obj["min"] = min;
+  obj["max"] = max;
+  obj["median"] = median;
+  obj["mean"] = mean;
+  obj["stddev"] = stddev;
+  obj["cv"] = cv();
+  return obj;
+}
@@ -0,0 +1,38 @@
+/*!
+  \file stats.h
+  \brief Summary statistics of repeated measurements.
+  \author Samuel Ng
+  \date 2021-03-29 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_STATS_H_
+#define _PT_STATS_H_
+
+#include <QtCore>
+
+namespace pt {
+
+  //! Summary of a set of samples.
+  struct SampleStats
+  {
+    int count=0;      //!< Sample count.
+    double min=0;     //!< Smallest sample.
+    double max=0;     //!< Largest sample.
+    double median=0;  //!< Median sample.
+    double mean=0;    //!< Sample mean.
+    double stddev=0;  //!< Sample standard deviation, 0 for fewer than 2 samples.
+
+    //! Return the coefficient of variation, 0 if the mean is 0.
+    double cv() const {return (mean != 0) ? stddev / mean : 0;}
+
+    //! Summarize the given samples.
+    static SampleStats of(QVector<double> samples);
+
+    //! Write the summary to a JSON object.
+    QJsonObject toJson() const;
+  };
+
+}
+
+#endif
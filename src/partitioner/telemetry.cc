@@ -0,0 +1,111 @@
+/*!
+  \file telemetry.cc
+  \author Samuel Ng
+  \date 2021-03-31 created
+  \copyright GNU LGPL v3
+  */
+
+#include "telemetry.h"
+#include <cmath>
+
+using namespace pt;
+
+// TelemetrySnapshot implementation
+
+double TelemetrySnapshot::fractionDone() const
+{
+  // estimates overflow to infinity for trees beyond about 2^1023 nodes
+  if (remaining_nodes < 0 || !std::isfinite(remaining_nodes)) {
+    return -1;
+  }
+  return (nodes + remaining_nodes > 0) ? nodes / (nodes + remaining_nodes) : 1.;
+}
+
+qint64 TelemetrySnapshot::eta(qint64 elapsed) const
+{
+  if (remaining_nodes < 0 || !std::isfinite(remaining_nodes) || nodes == 0) {
+    return -1;
+  }
+  // at the average node rate so far, unknown if beyond what fits
+  double eta = remaining_nodes * elapsed / nodes;
+  return (eta < 9e18) ? qint64(eta) : -1;
+}
+
+
+// Telemetry implementation
+
+Telemetry::Telemetry(int n_threads)
+  : best_cost_(-1)
+{
+  reset(n_threads);
+}
+
+Telemetry::~Telemetry()
+{
+  delete[] storage_;
+}
+
+void Telemetry::reset(int n_threads)
+{
+  delete[] storage_;
+  n_threads_ = n_threads;
+  // over-allocate so the shards can start on a line boundary, new only
+  // guarantees fundamental alignment before C++17
+  storage_ = new char[(n_threads + 1) * sizeof(Shard)];
+  quintptr base = reinterpret_cast<quintptr>(storage_);
+  base = (base + alignof(Shard) - 1) & ~quintptr(alignof(Shard) - 1);
+  shards_ = reinterpret_cast<Shard*>(base);
+  for (int tid=0; tid<n_threads; tid++) {
+    Shard *shard = new (&shards_[tid]) Shard;
+    shard->nodes.store(0);
+    shard->visited_leaves.store(0);
+    shard->pruned_leaves.store(0);
+    shard->remaining_nodes.store(-1);
+  }
+  best_cost_.store(-1);
+}
+
+quint64 Telemetry::totalNodes() const
+{
+  quint64 total = 0;
+  for (int tid=0; tid<n_threads_; tid++) {
+    total += nodes(tid);
+  }
+  return total;
+}
+
+bool Telemetry::offerBestCost(int cost)
+{
+  int best = best_cost_.load(std::memory_order_relaxed);
+  while (best < 0 || cost < best) {
+    if (best_cost_.compare_exchange_weak(best, cost, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TelemetrySnapshot Telemetry::snapshot() const
+{
+  TelemetrySnapshot snap;
+  snap.remaining_nodes = (n_threads_ > 0) ? 0 : -1;
+  snap.thread_nodes.resize(n_threads_);
+  snap.thread_visited_leaves.resize(n_threads_);
+  snap.thread_pruned_leaves.resize(n_threads_);
+  for (int tid=0; tid<n_threads_; tid++) {
+    snap.thread_nodes[tid] = nodes(tid);
+    snap.thread_visited_leaves[tid] = visitedLeaves(tid);
+    snap.thread_pruned_leaves[tid] = prunedLeaves(tid);
+    snap.nodes += snap.thread_nodes[tid];
+    snap.visited_leaves += snap.thread_visited_leaves[tid];
+    snap.pruned_leaves += snap.thread_pruned_leaves[tid];
+    double remaining = shards_[tid].remaining_nodes.load(std::memory_order_relaxed);
+    if (remaining < 0 || snap.remaining_nodes < 0) {
+      snap.remaining_nodes = -1;
+    } else {
+      snap.remaining_nodes += remaining;
+    }
+  }
+  snap.best_cut_size = bestCost();
+  return snap;
+}
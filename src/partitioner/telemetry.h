@@ -0,0 +1,126 @@
+/*!
+  \file telemetry.h
+  \brief Per-thread search counters with consistent snapshots.
+  \author Samuel Ng
+  \date 2021-03-31 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_TELEMETRY_H_
+#define _PT_TELEMETRY_H_
+
+#include <QtCore>
+#include <atomic>
+
+namespace pt {
+
+  //! Counter totals and per-thread values read at one point in time.
+  struct TelemetrySnapshot
+  {
+    quint64 nodes=0;            //!< Nodes processed by all threads.
+    quint64 visited_leaves=0;   //!< Leaves visited by all threads.
+    double pruned_leaves=0;     //!< Leaves pruned by all threads.
+    int best_cut_size=-1;       //!< Best cut found so far, -1 if none.
+    double remaining_nodes=-1;  //!< Estimated nodes left to process, -1 if unknown.
+    QVector<quint64> thread_nodes;          //!< Nodes processed by each thread.
+    QVector<quint64> thread_visited_leaves; //!< Leaves visited by each thread.
+    QVector<double> thread_pruned_leaves;   //!< Leaves pruned by each thread.
+
+    //! Return the estimated fraction of nodes processed, -1 if unknown.
+    double fractionDone() const;
+
+    //! Return the estimated ms left given the elapsed ms so far, -1 if unknown.
+    qint64 eta(qint64 elapsed) const;
+  };
+
+  /*! \brief Search counters sharded by worker thread.
+   *
+   * Each worker owns a shard on its own cache line and is its only writer,
+   * so updates are plain relaxed loads and stores without read-modify-write
+   * instructions or false sharing. Readers on any thread sum the shards.
+   * The totals of a snapshot are the sums of its per-thread values, and
+   * since every counter only grows, successive snapshots taken by one
+   * thread never go backwards. The best cost is shared by all workers and
+   * only ever lowered.
+   */
+  class Telemetry
+  {
+  public:
+    //! Construct telemetry for the given count of threads.
+    explicit Telemetry(int n_threads=0);
+
+    //! Destructor.
+    ~Telemetry();
+
+    //! Zero the counters and resize to the given count of threads.
+    void reset(int n_threads);
+
+    //! Return the count of threads.
+    int threadCount() const {return n_threads_;}
+
+    //! Count nodes processed by a thread, only called by that thread.
+    void addNodes(int tid, quint64 n) {add(shards_[tid].nodes, n);}
+
+    //! Count leaves visited by a thread, only called by that thread.
+    void addVisitedLeaves(int tid, quint64 n) {add(shards_[tid].visited_leaves, n);}
+
+    //! Count leaves pruned by a thread, only called by that thread.
+    void addPrunedLeaves(int tid, double n) {add(shards_[tid].pruned_leaves, n);}
+
+    /*! \brief Set the estimated nodes left for a thread, only called by that thread.
+     *
+     * Estimates start out unknown, and the total is unknown until every 
+     * thread has set one.
+     */
+    void setRemainingNodes(int tid, double n) {shards_[tid].remaining_nodes.store(n, std::memory_order_relaxed);}
+
+    //! Return the nodes processed by a thread.
+    quint64 nodes(int tid) const {return shards_[tid].nodes.load(std::memory_order_relaxed);}
+
+    //! Return the leaves visited by a thread.
+    quint64 visitedLeaves(int tid) const {return shards_[tid].visited_leaves.load(std::memory_order_relaxed);}
+
+    //! Return the leaves pruned by a thread.
+    double prunedLeaves(int tid) const {return shards_[tid].pruned_leaves.load(std::memory_order_relaxed);}
+
+    //! Return the nodes processed by all threads.
+    quint64 totalNodes() const;
+
+    //! Lower the best cost to the given cost, returns whether it was lowered.
+    bool offerBestCost(int cost);
+
+    //! Return the best cost, -1 if none.
+    int bestCost() const {return best_cost_.load(std::memory_order_relaxed);}
+
+    //! Return the counters of all threads.
+    TelemetrySnapshot snapshot() const;
+
+  private:
+    Q_DISABLE_COPY(Telemetry)
+
+    //! Counters of one thread, padded to a cache line.
+    struct alignas(64) Shard
+    {
+      std::atomic<quint64> nodes;
+      std::atomic<quint64> visited_leaves;
+      std::atomic<double> pruned_leaves;
+      std::atomic<double> remaining_nodes;
+    };
+
+    //! Add to a counter that only the calling thread writes.
+    template<typename T>
+    static void add(std::atomic<T> &counter, T n)
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + n,
+          std::memory_order_relaxed);
+    }
+
+    int n_threads_=0;             //!< Count of threads.
+    char *storage_=nullptr;       //!< Allocation holding the shards.
+    Shard *shards_=nullptr;       //!< Shards aligned within storage_.
+    std::atomic<int> best_cost_;  //!< Best cost over all threads.
+  };
+
+}
+
+#endif
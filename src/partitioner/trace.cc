@@ -0,0 +1,63 @@
+/*!
+  \file trace.cc
+  \author Samuel Ng
+  \date 2021-03-30 created
+  \copyright GNU LGPL v3
+  */
+
+#include "trace.h"
+
+using namespace pt;
+
+TraceRecorder::TraceRecorder(const QStringList &slot_names)
+  : start_(std::chrono::steady_clock::now()), slot_names_(slot_names),
+    slots_(slot_names.size()), dropped_(slot_names.size(), 0)
+{
+  for (QVector<Event> &events : slots_) {
+    events.reserve(4096);
+  }
+}
+
+bool TraceRecorder::write(const QString &f_path) const
+{
+  // streamed by hand since traces easily hold millions of events
+  QByteArray out;
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  auto us = [](qint64 ns) {return QByteArray::number(ns / 1000., 'f', 3);};
+  for (int slot=0; slot<slots_.size(); slot++) {
+    QByteArray tid = QByteArray::number(slot);
+    out += "{\"ph\":\"M\",\"pid\":1,\"tid\":" + tid
+      + ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+      + slot_names_[slot].toUtf8() + "\"}},\n";
+    if (dropped_[slot] > 0) {
+      out += "{\"ph\":\"i\",\"pid\":1,\"tid\":" + tid + ",\"s\":\"t\",\"ts\":"
+        + us(slots_[slot].last().ts) + ",\"name\":\"dropped "
+        + QByteArray::number(dropped_[slot]) + " events\"},\n";
+    }
+    for (const Event &e : slots_[slot]) {
+      out += "{\"ph\":\"";
+      out += e.phase;
+      out += "\",\"pid\":1,\"tid\":" + tid + ",\"name\":\"" + e.name
+        + "\",\"ts\":" + us(e.ts);
+      if (e.phase == 'X') {
+        out += ",\"dur\":" + us(e.dur);
+      } else if (e.phase == 'i') {
+        out += ",\"s\":\"t\"";
+      } else if (e.phase == 'C') {
+        out += ",\"args\":{\"value\":" + QByteArray::number(e.value, 'g', 17) + "}";
+      }
+      out += "},\n";
+    }
+  }
+  // the format tolerates no trailing comma, close with an empty metadata event
+  out += "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":"
+    "\"partitioner\"}}\n]}\n";
+
+  QSaveFile f(f_path);
+  if (!f.open(QIODevice::WriteOnly) || f.write(out) != out.size()
+      || !f.commit()) {
+    qWarning() << "Failed to write trace:" << f_path;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,95 @@
+/*!
+  \file trace.h
+  \brief Per-thread event recording in the Chrome trace-event format.
+  \author Samuel Ng
+  \date 2021-03-30 created
+  \copyright GNU LGPL v3
+  */
+
+#ifndef _PT_TRACE_H_
+#define _PT_TRACE_H_
+
+#include <QtCore>
+#include <chrono>
+
+namespace pt {
+
+  /*! \brief Records timestamped spans, instants and counters per thread.
+   *
+   * Each thread records into its own slot without locking, slots must not be
+   * shared between threads. Event names must be string literals since only
+   * their pointers are stored. Each slot holds at most max_events events,
+   * later events are dropped and counted.
+   *
+   * Callers hold a pointer to the recorder that is null when tracing is off,
+   * so that disabled tracing costs a single branch.
+   */
+  class TraceRecorder
+  {
+  public:
+    //! Maximum events kept per slot.
+    static const int max_events = 1 << 20;
+
+    //! Construct a recorder with the given slot names, one per thread.
+    TraceRecorder(const QStringList &slot_names);
+
+    //! Return the time since the recorder was constructed in ns.
+    qint64 now() const
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_).count();
+    }
+
+    //! Record a span that started at start_ns and ends now.
+    void span(int slot, const char *name, qint64 start_ns)
+    {
+      record(slot, {'X', name, start_ns, now() - start_ns, 0});
+    }
+
+    //! Record an instant event.
+    void instant(int slot, const char *name)
+    {
+      record(slot, {'i', name, now(), 0, 0});
+    }
+
+    //! Record a counter value.
+    void counter(int slot, const char *name, double value)
+    {
+      record(slot, {'C', name, now(), 0, value});
+    }
+
+    //! Write all slots to a trace-event JSON file, returns false on failure.
+    bool write(const QString &f_path) const;
+
+  private:
+
+    //! A recorded event.
+    struct Event
+    {
+      char phase;       //!< Trace-event phase.
+      const char *name; //!< Event name.
+      qint64 ts;        //!< Start time in ns.
+      qint64 dur;       //!< Duration in ns for spans.
+      double value;     //!< Value for counters.
+    };
+
+    //! Append an event to the slot unless it is full.
+    void record(int slot, const Event &event)
+    {
+      QVector<Event> &events = slots_[slot];
+      if (events.size() < max_events) {
+        events.append(event);
+      } else {
+        dropped_[slot]++;
+      }
+    }
+
+    std::chrono::steady_clock::time_point start_; //!< Time origin.
+    QStringList slot_names_;          //!< Thread name of each slot.
+    QVector<QVector<Event>> slots_;   //!< Events of each slot.
+    QVector<quint64> dropped_;        //!< Dropped event count of each slot.
+  };
+
+}
+
+#endif
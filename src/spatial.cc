@@ -8,6 +8,7 @@
 
 #include "spatial.h"
 #include <algorithm>
+#include <climits>
 
 using namespace sp;
 
@@ -17,48 +18,216 @@ using namespace sp;
 Graph::Graph(const QString &f_path)
 {
   QFile in_file(f_path);
-  if (!in_file.open(QFile::ReadOnly | QFile::Text)) {
+  if (!in_file.open(QFile::ReadOnly)) {
     qWarning() << "Unable to open file for reading.";
     return;
   }
 
-  // parse the file
-  int net_id = -1;
-  bool exit_cond = false;
-  while (!exit_cond) {
-    QString line = in_file.readLine().trimmed();
-    QStringList line_items = line.split(" ");
+  // map the file and parse straight from its bytes, falling back to reading
+  // it into memory for files that can't be mapped
+  qint64 size = in_file.size();
+  uchar *data = (size > 0) ? in_file.map(0, size) : nullptr;
+  bool mapped = data != nullptr;
+  QByteArray contents;
+  if (!mapped) {
+    contents = in_file.readAll();
+    data = (uchar*)contents.data();
+    size = contents.size();
+  }
+  const char *begin = (const char*)data;
+  if (isBinary(begin, begin + size)) {
+    parseBinary(begin, begin + size);
+  } else {
+    parseText(begin, begin + size);
+  }
+  if (mapped) {
+    in_file.unmap(data);
+  }
+  in_file.close();
+}
 
-    if (net_id == -1) {
-      // if the net ID is -1 then read the problem definition
-      if (line_items.size() != 2) {
-        qWarning("First line of the input file must contain 2 values. File invalid.");
-        return;
+Graph Graph::fromText(const QByteArray &contents)
+{
+  Graph graph;
+  graph.parseText(contents.constData(), contents.constData() + contents.size());
+  return graph;
+}
+
+Graph Graph::fromNets(int n_blocks, const QVector<QVector<int>> &nets)
+{
+  Graph graph;
+  graph.net_offsets_.reserve(nets.size() + 1);
+  graph.net_offsets_.append(0);
+  for (const QVector<int> &net : nets) {
+    for (int bid : net) {
+      if (bid < 0 || bid >= n_blocks) {
+        qWarning() << "Block ID" << bid << "out of range.";
+        return Graph();
+      }
+    }
+    graph.net_blocks_.append(net);
+    graph.net_offsets_.append(graph.net_blocks_.size());
+  }
+  graph.n_blocks_ = n_blocks;
+  graph.n_nets_ = nets.size();
+  graph.buildBlockNets();
+  return graph;
+}
+
+namespace {
+
+  // binary netlist layout, all values are little-endian quint32:
+  //   magic, version, n_blocks, n_nets, n_pins, payload checksum,
+  //   32 bytes of canonical hash,
+  //   net offsets (n_nets+1), net block IDs (n_pins)
+  // the block to net adjacency is derived from the nets on load
+  const quint32 bin_magic = 0x4c4e5450;  // "PTNL" when read as bytes
+  const quint32 bin_version = 1;
+  const int bin_hash_size = 32;
+  const int bin_header_size = 6*4 + bin_hash_size;
+  const quint32 bin_checksum_seed = 0x811c9dc5;
+
+  //! Fold a payload value into the FNV-1a style payload checksum.
+  inline quint32 mixChecksum(quint32 checksum, quint32 v)
+  {
+    return (checksum ^ v) * 0x01000193;
+  }
+
+  //! Read the i-th little-endian quint32 from an array.
+  inline quint32 readU32(const char *arr, qint64 i)
+  {
+    return qFromLittleEndian<quint32>((const uchar*)arr + 4*i);
+  }
+
+  //! Append a little-endian quint32 to a byte array.
+  inline void appendU32(QByteArray &out, quint32 v)
+  {
+    uchar bytes[4];
+    qToLittleEndian(v, bytes);
+    out.append((const char*)bytes, 4);
+  }
+
+  //! Cursor over netlist text that keeps track of the line number.
+  struct TextCursor
+  {
+    const char *p;    //!< Current position.
+    const char *end;  //!< End of the text.
+    int line;         //!< Current line number, starting from 1.
+
+    //! Skip spaces within the current line.
+    void skipSpaces()
+    {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+      }
+    }
+
+    //! Return whether there are no more values on the current line.
+    bool atLineEnd()
+    {
+      skipSpaces();
+      return p >= end || *p == '\n';
+    }
+
+    //! Move to the start of the next line, returns false if there is none.
+    bool nextLine()
+    {
+      while (p < end && *p != '\n') {
+        ++p;
+      }
+      if (p < end) {
+        ++p;
+        ++line;
       }
-      // read the values and assign Graph pointer
-      n_blocks_ = line_items[0].toInt();
-      n_nets_ = line_items[1].toInt();
-      all_block_net_ids_.resize(n_blocks_);
-      nets_.resize(n_nets_);
-    } else {
-      // read net definitions and add to Graph
-      int num_blocks = line_items[0].toInt();
-      QVector<int> conn_blocks;
-      for (int it_id=1; it_id < line_items.size(); it_id++) {
-        conn_blocks.push_back(line_items[it_id].toInt());
+      return p < end;
+    }
+
+    //! Read a non-negative integer, returns false if the next value isn't one.
+    bool readInt(int &val)
+    {
+      skipSpaces();
+      const char *start = p;
+      qint64 v = 0;
+      while (p < end && *p >= '0' && *p <= '9' && v <= INT_MAX) {
+        v = v*10 + (*p - '0');
+        ++p;
+      }
+      if (p == start || v > INT_MAX
+          || (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')) {
+        return false;
+      }
+      val = (int)v;
+      return true;
+    }
+  };
+
+}
+
+void Graph::parseText(const char *begin, const char *end)
+{
+  TextCursor cur = {begin, end, 1};
+
+  // read the problem definition
+  int n_blocks, n_nets;
+  if (!cur.readInt(n_blocks) || !cur.readInt(n_nets) || !cur.atLineEnd()) {
+    qWarning("First line of the input file must contain 2 values. File invalid.");
+    invalidate();
+    return;
+  }
+  // every net takes at least a line and every connected block an ID, so
+  // larger counts can only come from a malformed header
+  if (n_nets > end - begin || n_blocks > end - begin) {
+    qWarning("Block or net count exceeds what the file can hold. File invalid.");
+    invalidate();
+    return;
+  }
+  n_blocks_ = n_blocks;
+  n_nets_ = n_nets;
+  net_offsets_.reserve(n_nets_ + 1);
+  net_offsets_.append(0);
+
+  // read net definitions directly into the graph, a blank line is a net
+  // without blocks
+  int net_id = 0;
+  while (net_id < n_nets_ && cur.nextLine()) {
+    int num_blocks = 0;
+    if (!cur.atLineEnd() && !cur.readInt(num_blocks)) {
+      qWarning() << QString("Line %1: invalid block count.").arg(cur.line);
+      invalidate();
+      return;
+    }
+    int net_start = net_blocks_.size();
+    while (!cur.atLineEnd()) {
+      int bid;
+      if (!cur.readInt(bid)) {
+        qWarning() << QString("Line %1: invalid block ID.").arg(cur.line);
+        invalidate();
+        return;
       }
-      if (num_blocks != conn_blocks.size()) {
-        qFatal("Mismatching block counts encountered while reading input file.");
+      if (bid >= n_blocks_) {
+        qWarning() << QString("Line %1: block ID %2 out of range.")
+          .arg(cur.line).arg(bid);
+        invalidate();
+        return;
       }
-      setNet(net_id, conn_blocks);
+      net_blocks_.append(bid);
+    }
+    if (num_blocks != net_blocks_.size() - net_start) {
+      qWarning() << QString("Line %1: mismatching block counts encountered "
+          "while reading input file.").arg(cur.line);
+      invalidate();
+      return;
     }
+    net_offsets_.append(net_blocks_.size());
     net_id++;
-    exit_cond = (in_file.atEnd() || net_id >= n_nets_);
   }
-  if (net_id == -1) {
-    qWarning() << "Nothing was read. Check input file.";
+  if (net_id < n_nets_) {
+    qWarning() << QString("File ends after %1 of %2 nets. File invalid.")
+      .arg(net_id).arg(n_nets_);
+    invalidate();
+    return;
   }
-  in_file.close();
+  buildBlockNets();
 
   // sanity check on the produced Graph
   if (!allBlocksConnected()) {
@@ -67,18 +236,263 @@ Graph::Graph(const QString &f_path)
   }
 }
 
-void Graph::setNet(int net_id, const QVector<int> &conn_blocks)
+bool Graph::isBinary(const char *begin, const char *end)
 {
-  nets_[net_id] = conn_blocks;
-  for (int b_id : conn_blocks) {
-    all_block_net_ids_[b_id].append(net_id);
+  return end - begin >= 4 && readU32(begin, 0) == bin_magic;
+}
+
+void Graph::parseBinary(const char *begin, const char *end)
+{
+  qint64 size = end - begin;
+  if (size < bin_header_size || readU32(begin, 1) != bin_version) {
+    qWarning("Unsupported binary netlist version. File invalid.");
+    invalidate();
+    return;
+  }
+  quint32 n_blocks = readU32(begin, 2);
+  quint32 n_nets = readU32(begin, 3);
+  quint32 n_pins = readU32(begin, 4);
+  qint64 n_values = (qint64)n_pins + n_nets + 1;
+  if (n_blocks > INT_MAX || n_nets > INT_MAX || n_pins > INT_MAX
+      || size != bin_header_size + 4*n_values) {
+    qWarning("Binary netlist size doesn't match its header. File invalid.");
+    invalidate();
+    return;
+  }
+  const char *net_offsets = begin + bin_header_size;
+  const char *net_blocks = net_offsets + 4*((qint64)n_nets + 1);
+
+  // copy the nets into the flat arrays while checksumming the payload in 
+  // file order, then check that offsets and IDs are in range so that 
+  // corrupted files can't cause overruns
+  net_offsets_.resize(n_nets + 1);
+  net_blocks_.resize(n_pins);
+  quint32 checksum = bin_checksum_seed;
+  for (quint32 nid=0; nid<=n_nets; nid++) {
+    quint32 offset = readU32(net_offsets, nid);
+    net_offsets_[nid] = offset;
+    checksum = mixChecksum(checksum, offset);
+  }
+  bool valid = net_offsets_[0] == 0 && (quint32)net_offsets_[n_nets] == n_pins;
+  for (quint32 nid=0; valid && nid<n_nets; nid++) {
+    valid = net_offsets_[nid+1] >= net_offsets_[nid];
+  }
+  for (quint32 i=0; i<n_pins; i++) {
+    quint32 bid = readU32(net_blocks, i);
+    net_blocks_[i] = bid;
+    valid = valid && bid < n_blocks;
+    checksum = mixChecksum(checksum, bid);
+  }
+  if (!valid) {
+    qWarning("Corrupted adjacency in binary netlist. File invalid.");
+    invalidate();
+    return;
+  }
+  if (checksum != readU32(begin, 5)) {
+    qWarning("Binary netlist checksum mismatch. File invalid.");
+    invalidate();
+    return;
+  }
+
+  // the block to net adjacency is derived rather than stored
+  n_blocks_ = n_blocks;
+  n_nets_ = n_nets;
+  buildBlockNets();
+  stored_hash_ = QByteArray(begin + 6*4, bin_hash_size);
+}
+
+bool Graph::writeBinary(const QString &f_path) const
+{
+  if (!isValid()) {
+    qWarning() << "Refusing to write an invalid graph to" << f_path;
+    return false;
+  }
+
+  // the nets are already flat, write them out after the header
+  quint32 checksum = bin_checksum_seed;
+  auto appendArray = [&checksum](QByteArray &out, const QVector<int> &arr) {
+    for (int v : arr) {
+      appendU32(out, v);
+      checksum = mixChecksum(checksum, v);
+    }
+  };
+  quint32 n_pins = numPins();
+  QByteArray payload;
+  payload.reserve(4*(n_pins + n_nets_ + 1));
+  appendArray(payload, net_offsets_);
+  appendArray(payload, net_blocks_);
+
+  QByteArray out;
+  out.reserve(bin_header_size + payload.size());
+  appendU32(out, bin_magic);
+  appendU32(out, bin_version);
+  appendU32(out, n_blocks_);
+  appendU32(out, n_nets_);
+  appendU32(out, n_pins);
+  appendU32(out, checksum);
+  out.append(canonicalHash());
+  out.append(payload);
+
+  QSaveFile f(f_path);
+  if (!f.open(QIODevice::WriteOnly) || f.write(out) != out.size()
+      || !f.commit()) {
+    qWarning() << "Failed to write binary netlist:" << f_path;
+    return false;
+  }
+  return true;
+}
+
+bool Graph::writeText(const QString &f_path) const
+{
+  if (!isValid()) {
+    qWarning() << "Refusing to write an invalid graph to" << f_path;
+    return false;
+  }
+
+  QByteArray out;
+  out.reserve(8*(numPins() + n_nets_) + 32);
+  out += QByteArray::number(n_blocks_) + ' ' + QByteArray::number(n_nets_) + '\n';
+  for (int nid=0; nid<n_nets_; nid++) {
+    IdSpan blocks = net(nid);
+    out += QByteArray::number(blocks.size());
+    for (int bid : blocks) {
+      out += ' ' + QByteArray::number(bid);
+    }
+    out += '\n';
+  }
+
+  QSaveFile f(f_path);
+  if (!f.open(QIODevice::WriteOnly) || f.write(out) != out.size()
+      || !f.commit()) {
+    qWarning() << "Failed to write netlist:" << f_path;
+    return false;
+  }
+  return true;
+}
+
+Graph Graph::withLocalNetOrder() const
+{
+  if (!isValid()) {
+    return *this;
+  }
+
+  // number nets by first appearance when walking blocks in order
+  QVector<int> new_ids(n_nets_, -1);
+  int next_id = 0;
+  for (int nid : block_nets_) {
+    if (new_ids[nid] == -1) {
+      new_ids[nid] = next_id++;
+    }
+  }
+  for (int &new_id : new_ids) {
+    if (new_id == -1) {
+      new_id = next_id++;   // nets without blocks go last
+    }
+  }
+  bool unchanged = true;
+  for (int nid=0; nid<n_nets_ && unchanged; nid++) {
+    unchanged = new_ids[nid] == nid;
+  }
+  if (unchanged) {
+    Graph graph = *this;  // shares the arrays
+    graph.local_net_order_ = true;
+    return graph;
+  }
+
+  Graph graph;
+  graph.n_blocks_ = n_blocks_;
+  graph.n_nets_ = n_nets_;
+  QVector<int> old_ids(n_nets_);
+  for (int nid=0; nid<n_nets_; nid++) {
+    old_ids[new_ids[nid]] = nid;
+  }
+  graph.net_offsets_.reserve(n_nets_ + 1);
+  graph.net_offsets_.append(0);
+  graph.net_blocks_.reserve(numPins());
+  for (int old_id : old_ids) {
+    for (int bid : net(old_id)) {
+      graph.net_blocks_.append(bid);
+    }
+    graph.net_offsets_.append(graph.net_blocks_.size());
+  }
+  graph.buildBlockNets();
+  graph.stored_hash_ = stored_hash_;  // the hash ignores net order
+  graph.local_net_order_ = true;
+  return graph;
+}
+
+void Graph::buildBlockNets()
+{
+  // count the nets of each block, then fill in net order so that the nets of
+  // each block stay sorted by ID
+  block_offsets_.fill(0, n_blocks_ + 1);
+  for (int bid : net_blocks_) {
+    block_offsets_[bid+1]++;
+  }
+  for (int bid=0; bid<n_blocks_; bid++) {
+    block_offsets_[bid+1] += block_offsets_[bid];
+  }
+  block_nets_.resize(net_blocks_.size());
+  QVector<int> fill_pos = block_offsets_;
+  for (int nid=0; nid<n_nets_; nid++) {
+    for (int bid : net(nid)) {
+      block_nets_[fill_pos[bid]++] = nid;
+    }
+  }
+}
+
+void Graph::invalidate()
+{
+  n_blocks_ = -1;
+  n_nets_ = -1;
+  net_offsets_.clear();
+  net_blocks_.clear();
+  block_offsets_.clear();
+  block_nets_.clear();
+  stored_hash_.clear();
+}
+
+QByteArray Graph::canonicalHash() const
+{
+  // mix each net with its blocks sorted into a 64-bit value
+  QVector<quint64> net_hashes;
+  net_hashes.reserve(n_nets_);
+  for (int nid=0; nid<n_nets_; nid++) {
+    QVector<int> blocks = net(nid).toVector();
+    std::sort(blocks.begin(), blocks.end());
+    quint64 h = 0xcbf29ce484222325ULL ^ (quint64)blocks.size();
+    for (int bid : blocks) {
+      h = (h ^ (quint64)bid) * 0x100000001b3ULL;
+      h ^= h >> 29;
+    }
+    net_hashes.append(h);
+  }
+  std::sort(net_hashes.begin(), net_hashes.end());
+
+  // hash the sorted net values in a fixed byte order
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  QByteArray bytes(8, '\0');
+  auto addValue = [&hash, &bytes](quint64 v) {
+    qToLittleEndian(v, (uchar*)bytes.data());
+    hash.addData(bytes);
+  };
+  addValue((quint64)n_blocks_);
+  addValue((quint64)n_nets_);
+  for (quint64 h : net_hashes) {
+    addValue(h);
+  }
+  QByteArray result = hash.result();
+  if (!stored_hash_.isEmpty() && stored_hash_ != result) {
+    qWarning("Binary netlist carries a stale canonical hash, using the "
+        "recomputed one.");
   }
+  return result;
 }
 
 bool Graph::allBlocksConnected() const
 {
-  for (const QVector<int> &block_net_ids : all_block_net_ids_) {
-    if (block_net_ids.isEmpty()) {
+  for (int bid=0; bid<n_blocks_; bid++) {
+    if (blockNets(bid).isEmpty()) {
       return false;
     }
   }
@@ -101,7 +515,7 @@ int Chip::calcCostDelta(const Graph &graph, const QVector<int> &block_part,
     int bid, int part, QVector<int> &curr_net_costs)
 {
   // get the nets that associate with this block
-  const QVector<int> &block_nets = graph.blockNets(bid);
+  IdSpan block_nets = graph.blockNets(bid);
 
   // calculate the current cost of those nets
   int cost_i = 0;
@@ -132,7 +546,7 @@ int Chip::netCost(int nid, const Graph &graph, const QVector<int> &block_part,
   bool in_part_a = false;
   bool in_part_b = false;
   // iterate through all blocks in the net to see if a crossing exists
-  const QVector<int> &blocks = graph.net(nid);
+  IdSpan blocks = graph.net(nid);
   for (int bid : blocks) {
     // get the assigned partition or take the overriden partition
     int part = (override_bid == bid) ? override_part : block_part[bid];
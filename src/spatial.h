@@ -9,26 +9,109 @@
 #ifndef _SP_SPATIAL_H_
 #define _SP_SPATIAL_H_
 
-#include <QtWidgets>
+#include <QtCore>
+#include <algorithm>
 
 namespace sp {
 
+  /*! \brief Read-only view over a contiguous run of IDs.
+   *
+   * Spans stay valid as long as the Graph they came from is alive and 
+   * unmodified.
+   */
+  class IdSpan
+  {
+  public:
+    //! Construct a span over [begin, end).
+    IdSpan(const int *begin, const int *end) : begin_(begin), end_(end) {};
+
+    const int *begin() const {return begin_;}
+    const int *end() const {return end_;}
+    int size() const {return (int)(end_ - begin_);}
+    bool isEmpty() const {return begin_ == end_;}
+    int operator[](int i) const {return begin_[i];}
+
+    //! Return a copy of the IDs.
+    QVector<int> toVector() const
+    {
+      QVector<int> vec(size());
+      std::copy(begin_, end_, vec.begin());
+      return vec;
+    }
+
+  private:
+    const int *begin_;  //!< First ID.
+    const int *end_;    //!< One past the last ID.
+  };
+
   /*! \brief Graph of blocks and nets.
    *
    * Graph-like data structure with nodes denoting blocks. This class has no 
    * knowledge about the actual spatial placement of the blocks.
+   *
+   * Adjacency is kept in compressed sparse row form in both directions: the 
+   * blocks of net i are net_blocks_[net_offsets_[i] .. net_offsets_[i+1]) and 
+   * likewise for the nets of each block. Copies share the arrays implicitly.
    */
   class Graph
   {
   public:
-    //! Constructor taking the input file path to be read.
+    /*! \brief Constructor taking the input file path to be read.
+     *
+     * Both the text input file format and the binary netlist format written
+     * by writeBinary() are accepted, the format is detected from the file 
+     * contents.
+     */
     Graph(const QString &f_path);
 
-    //! Constructor taking the number of blocks and nets expected.
-    //Graph(int n_blocks, int n_nets);
+    //! Construct an empty and invalid graph.
+    Graph() {};
+
+    //! Construct a graph from netlist contents in the input file format.
+    static Graph fromText(const QByteArray &contents);
+
+    //! Construct a graph from a list of nets, invalid if a block ID is out of range.
+    static Graph fromNets(int n_blocks, const QVector<QVector<int>> &nets);
+
+    //! Return whether a problem has been read successfully.
+    bool isValid() const {return n_blocks_ >= 0 && n_nets_ >= 0;}
+
+    /*! \brief Return a canonical hash of the graph.
+     *
+     * The SHA-256 hash only depends on the block count and the set of nets,
+     * so it ignores the order of nets and the order of blocks within a net. 
+     * Block IDs are not canonicalized since assignments refer to them. The 
+     * hash is computed on every call, so callers should only ask for it when 
+     * they need a key. Graphs loaded from binary netlists warn if the stored 
+     * hash doesn't match.
+     */
+    QByteArray canonicalHash() const;
+
+    /*! \brief Write the graph in the binary netlist format.
+     *
+     * The binary format stores the block and net counts, a payload checksum, 
+     * the canonical hash and the nets as flat little-endian offset and block 
+     * ID arrays so that loading involves no parsing. Returns false on failure.
+     */
+    bool writeBinary(const QString &f_path) const;
 
-    //! Set the connected blocks for the specified net ID.
-    void setNet(int net_id, const QVector<int> &conn_blocks);
+    //! Write the graph in the text input file format, returns false on failure.
+    bool writeText(const QString &f_path) const;
+
+    //! Return whether the contents start with the binary netlist magic.
+    static bool isBinary(const char *begin, const char *end);
+
+    /*! \brief Return a copy with nets renumbered for memory locality.
+     *
+     * Nets are numbered in the order they are first reached when walking 
+     * blocks by ascending ID, which is the order the search assigns blocks 
+     * in, so nets touched by consecutive blocks sit next to each other. Block
+     * IDs are unchanged so assignments remain valid for the original graph.
+     */
+    Graph withLocalNetOrder() const;
+
+    //! Return whether the graph was produced by withLocalNetOrder().
+    bool hasLocalNetOrder() const {return local_net_order_;}
 
     //! Check check all blocks have some connection.
     bool allBlocksConnected() const;
@@ -39,29 +122,60 @@ namespace sp {
     //! Get net count.
     int numNets() const {return n_nets_;}
 
-    //! Return all nets.
-    const QVector<QVector<int>> &nets() const {return nets_;}
+    //! Get the total count of block to net connections.
+    int numPins() const {return net_blocks_.size();}
 
-    //! Return the net with the specified ID.
-    const QVector<int> &net(int nid) const {return nets_[nid];}
+    //! Return the block IDs in the net with the specified ID.
+    IdSpan net(int nid) const
+    {
+      const int *ids = net_blocks_.constData();
+      return IdSpan(ids + net_offsets_[nid], ids + net_offsets_[nid+1]);
+    }
 
-    //! Return block net connectivity records.
-    const QVector<QVector<int>> &allBlockNets() const {return all_block_net_ids_;}
-    
-    //! Return the net connectivity of a single net.
-    const QVector<int> &blockNets(int bid) const {return all_block_net_ids_[bid];}
+    //! Return the net IDs connected to the block with the specified ID.
+    IdSpan blockNets(int bid) const
+    {
+      const int *ids = block_nets_.constData();
+      return IdSpan(ids + block_offsets_[bid], ids + block_offsets_[bid+1]);
+    }
 
   private:
 
+    /*! \brief Parse the problem from text in the input file format.
+     *
+     * Integers are parsed straight from the bytes into the graph storage.
+     * Errors are reported with line numbers and invalidate the graph.
+     */
+    void parseText(const char *begin, const char *end);
+
+    //! Load the problem from the binary netlist format, invalidates on error.
+    void parseBinary(const char *begin, const char *end);
+
+    //! Derive the block to net adjacency from the net to block adjacency.
+    void buildBlockNets();
+
+    //! Reset to an empty and invalid graph.
+    void invalidate();
+
     int n_blocks_=-1; //!< Number of blocks.
     int n_nets_=-1;   //!< Number of nets.
 
-    //! List of nets where each net consists of a list of block IDs.
-    QVector<QVector<int>> nets_;
-    //! For each block, store a list of associated net IDs.
-    QVector<QVector<int>> all_block_net_ids_;
+    QVector<int> net_offsets_;    //!< Start of each net in net_blocks_, plus the end.
+    QVector<int> net_blocks_;     //!< Block IDs of all nets back to back.
+    QVector<int> block_offsets_;  //!< Start of each block in block_nets_, plus the end.
+    QVector<int> block_nets_;     //!< Net IDs of all blocks back to back.
+    //! Canonical hash stored in a binary netlist, empty if it isn't known.
+    QByteArray stored_hash_;
+    bool local_net_order_=false;  //!< Whether nets are in local order.
   };
 
+  /*! \brief Shared handle to an immutable graph.
+   *
+   * A loaded graph is frozen behind this handle and shared read-only by the 
+   * partitioner, its workers, the job queue and the GUI viewers.
+   */
+  typedef QSharedPointer<const Graph> GraphPtr;
+
   /*! \brief Chip containing two partitions for the graph to be mapped onto.
    *
    * The chip on which the problem graph is to be mapped onto.
@@ -9,8 +9,21 @@
 #include <QtTest/QtTest>
 #include<QtTest/QSignalSpy>
 #include <QJsonObject>
+#include <cmath>
+#include <thread>
 #include "partitioner/partitioner.h"
-#include "gui/settings.h"
+#include "partitioner/checkpoint.h"
+#include "partitioner/jobs.h"
+#include "partitioner/resultcache.h"
+#include "partitioner/daemon.h"
+#include "partitioner/batch.h"
+#include "partitioner/pjson.h"
+#include "partitioner/incremental.h"
+#include "partitioner/generator.h"
+#include "partitioner/bench.h"
+#include "partitioner/stats.h"
+#include "partitioner/repeat.h"
+#include "partitioner/estimator.h"
 
 class PartitionerTests : public QObject
 {
@@ -81,9 +94,882 @@ class PartitionerTests : public QObject
 
         // check that partitioner returns the expected results
         PSettings pset;
-        PartitionerBusyWrapper partitioner(graph, pset);
-        PResults results = partitioner.runPartitioner();
+        PResults results = JobRunner::global()->submit(graph, pset).result();
         QCOMPARE(results.best_cut_size, expected_props["cut_size"]);
+        QVERIFY(results.proven_optimal);
+        QCOMPARE(results.lower_bound, results.best_cut_size);
+      }
+    }
+
+    //! Test that several jobs can be kept in flight and cancelled.
+    void testJobs()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      QStringList p_names;
+      p_names << "atest2" << "atest3" << "atest4" << "baby";
+
+      // submit all jobs before waiting on any of them
+      JobRunner runner(2);
+      QObject receiver;
+      int finished_count = 0;
+      connect(&runner, &JobRunner::sig_jobFinished, &receiver,
+          [&finished_count](quint64, const PResults &) {finished_count++;});
+      QList<JobHandle> jobs;
+      for (QString p_name : p_names) {
+        jobs.append(runner.submit(Graph(":/test_problems/" + p_name + ".txt")));
+      }
+      for (int i=0; i<p_names.size(); i++) {
+        QVariantMap expected_props = readTestProps(":/test_problems/"
+            + p_names[i] + "_props.json");
+        PResults results = jobs[i].result();
+        QVERIFY(jobs[i].isFinished());
+        QCOMPARE(jobs[i].progress().state, PProgress::Finished);
+        QCOMPARE(results.best_cut_size, expected_props["cut_size"].toInt());
+      }
+      QTRY_COMPARE(finished_count, p_names.size());
+
+      // cancelling a finished job has no effect
+      jobs[0].cancel();
+      QVERIFY(jobs[0].result().proven_optimal);
+
+      // invalid graphs finish straight away with empty results
+      JobHandle invalid_job = runner.submit(Graph());
+      QCOMPARE(invalid_job.result().best_cut_size, -1);
+      QVERIFY(invalid_job.result().best_assignment.isEmpty());
+      QCOMPARE(invalid_job.progress().state, PProgress::Finished);
+    }
+
+    //! Test that the run report carries the assignment and per-thread counts.
+    void testRunReport()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      GraphPtr graph(new Graph(":/test_problems/baby.txt"));
+      PSettings pset;
+      pset.threads = 2;
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      QJsonObject report = PJson::runToJson("baby.txt", *graph, pset, results);
+      QCOMPARE(report["schema_version"].toInt(), PJson::run_schema_version);
+      QCOMPARE(report["graph"].toObject()["num_blocks"].toInt(), graph->numBlocks());
+
+      QJsonObject res = report["results"].toObject();
+      QCOMPARE(res["assignment"].toArray().size(), graph->numBlocks());
+      QCOMPARE(res["threads"].toInt(), results.threads);
+      QJsonArray per_thread = res["per_thread"].toArray();
+      QCOMPARE(per_thread.size(), results.threads);
+      double thread_nodes = 0;
+      for (const QJsonValue &th : per_thread) {
+        thread_nodes += th.toObject()["nodes"].toDouble();
+      }
+      QCOMPARE(thread_nodes, res["nodes"].toDouble());
+    }
+
+    //! Test that search statistics account for every processed node.
+    void testSearchStats()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      Graph graph(":/test_problems/atest3.txt");
+      for (int threads : {1, 4}) {
+        PSettings pset;
+        pset.threads = threads;
+        PResults results = JobRunner::global()->submit(graph, pset).result();
+        const SearchStats &stats = results.stats;
+        QCOMPARE(stats.expanded_nodes + stats.visited_leaves + stats.totalPrunes(),
+            results.nodes);
+        QCOMPARE(stats.visited_leaves, results.visited_leaves);
+        QCOMPARE(stats.prunes(MirrorPrune), (quint64)1);
+        QCOMPARE(stats.prunes_by_depth[MirrorPrune][1], (quint64)1);
+        QVERIFY(stats.max_stack_depth > 0);
+
+        // the totals are the sums over the threads
+        QCOMPARE(results.thread_stats.size(), results.threads);
+        quint64 thread_expanded = 0;
+        for (int tid=0; tid<results.thread_stats.size(); tid++) {
+          thread_expanded += results.thread_stats[tid].expanded_nodes;
+          QCOMPARE(results.thread_stats[tid].visited_leaves,
+              results.thread_visited_leaves[tid]);
+        }
+        QCOMPARE(thread_expanded, stats.expanded_nodes);
+      }
+
+      // copied snapshots don't share histograms with the worker's own
+      SearchStats worker, posted;
+      worker.init(graph.numBlocks());
+      posted.init(graph.numBlocks());
+      worker.expanded_by_depth[2] = 5;
+      const quint64 *posted_data = posted.expanded_by_depth.constData();
+      posted.copyFrom(worker);
+      QCOMPARE(posted.expanded_by_depth.constData(), posted_data);
+      QCOMPARE(posted.expanded_by_depth[2], (quint64)5);
+      worker.expanded_by_depth[2]++;
+      QCOMPARE(posted.expanded_by_depth[2], (quint64)5);
+    }
+
+    //! Test that sharded counters add up and that snapshots never go backwards.
+    void testTelemetry()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      Telemetry telem(4);
+      std::vector<std::thread> writers;
+      for (int tid=0; tid<4; tid++) {
+        writers.emplace_back([&telem, tid]() {
+          for (int i=0; i<100000; i++) {
+            telem.addNodes(tid, 2);
+            telem.addVisitedLeaves(tid, 1);
+            telem.addPrunedLeaves(tid, 0.5);
+          }
+          telem.offerBestCost(10 + tid);
+        });
+      }
+      TelemetrySnapshot prev;
+      for (int i=0; i<100; i++) {
+        TelemetrySnapshot snap = telem.snapshot();
+        QVERIFY(snap.nodes >= prev.nodes);
+        QVERIFY(snap.visited_leaves >= prev.visited_leaves);
+        QCOMPARE(snap.nodes, std::accumulate(snap.thread_nodes.cbegin(),
+              snap.thread_nodes.cend(), (quint64)0));
+        prev = snap;
+      }
+      for (std::thread &writer : writers) {
+        writer.join();
+      }
+      TelemetrySnapshot snap = telem.snapshot();
+      QCOMPARE(snap.nodes, (quint64)800000);
+      QCOMPARE(snap.visited_leaves, (quint64)400000);
+      QCOMPARE(snap.pruned_leaves, 200000.);
+      QCOMPARE(snap.best_cut_size, 10);
+      QVERIFY(!telem.offerBestCost(11));
+      QVERIFY(telem.offerBestCost(9));
+
+      // progress of a running job is monotonic and ends at the results
+      Graph graph(":/test_problems/atest3.txt");
+      PSettings pset;
+      pset.threads = 4;
+      JobHandle job = JobRunner::global()->submit(graph, pset);
+      PProgress last;
+      while (!job.waitFor(1)) {
+        PProgress prog = job.progress();
+        QVERIFY(prog.nodes >= last.nodes);
+        QVERIFY(prog.visited_leaves >= last.visited_leaves);
+        last = prog;
+      }
+      PResults results = job.result();
+      QVERIFY(results.nodes >= last.nodes);
+      QCOMPARE(results.visited_leaves, std::accumulate(
+            results.thread_visited_leaves.cbegin(),
+            results.thread_visited_leaves.cend(), (quint64)0));
+    }
+
+    //! Test remaining work estimates against known trees and running searches.
+    void testWorkEstimator()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      // with nothing seen every subtree is complete
+      WorkEstimator est(4);
+      QCOMPARE(est.subtreeNodes(4), 1.);
+      QCOMPARE(est.subtreeNodes(0), 31.);
+
+      // half of the nodes at depth 2 are pruned, depth 3 borrows from depth 2
+      SearchStats stats;
+      stats.init(4);
+      stats.expanded_by_depth[0] = 1;
+      stats.expanded_by_depth[1] = 2;
+      stats.expanded_by_depth[2] = 2;
+      stats.prunes_by_depth[CostPrune][2] = 2;
+      est.update(stats);
+      QCOMPARE(est.subtreeNodes(3), 2.);
+      QCOMPARE(est.subtreeNodes(2), 3.);
+      QCOMPARE(est.subtreeNodes(1), 7.);
+      QStack<ProblemNodeParams> stack;
+      stack.push(ProblemNodeParams(QVector<int>(4, 0), 2, 2, 0, QVector<int>()));
+      stack.push(ProblemNodeParams(QVector<int>(4, 0), 3, 3, 0, QVector<int>()));
+      QCOMPARE(est.remainingNodes(stack), 5.);
+
+      // estimates beyond the range of a double are unknown
+      WorkEstimator huge(2000);
+      QVERIFY(!std::isfinite(huge.subtreeNodes(0)));
+      TelemetrySnapshot snap;
+      snap.nodes = 100;
+      snap.remaining_nodes = huge.subtreeNodes(0);
+      QCOMPARE(snap.fractionDone(), -1.);
+      QCOMPARE(snap.eta(0), (qint64)-1);
+      QCOMPARE(snap.eta(1000), (qint64)-1);
+
+      // completed runs are done, stopped runs have something left
+      Graph graph(":/test_problems/atest2.txt");
+      PSettings pset;
+      pset.threads = 2;
+      PResults completed = JobRunner::global()->submit(graph, pset).result();
+      QCOMPARE(completed.fraction_done, 1.);
+      QCOMPARE(completed.eta, (qint64)0);
+      QVector<QVector<int>> nets;
+      for (int bid=0; bid<39; bid++) {
+        nets.append({bid, bid+1});
+      }
+      pset.node_limit = 5000;
+      PResults stopped = JobRunner::global()->submit(Graph::fromNets(40, nets),
+          pset).result();
+      QCOMPARE(stopped.stop_reason, NodeLimit);
+      QVERIFY(stopped.fraction_done > 0 && stopped.fraction_done < 1);
+      QVERIFY(stopped.eta >= 0);
+    }
+
+    //! Test that verbose search events round trip through binary logs.
+    void testEventLog()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      QVector<EventLimit> limits;
+      QVERIFY(EventLog::parseLimits("leaf=2:0, cost=10", limits));
+      QCOMPARE(limits[LeafEvent].sample_every, 2);
+      QCOMPARE(limits[LeafEvent].max_per_sec, 0);
+      QCOMPARE(limits[CostPruneEvent].sample_every, 10);
+      QCOMPARE(limits[ImbalancePruneEvent].sample_every, 1);
+      QVERIFY(!EventLog::parseLimits("leaf=0", limits));
+      QVERIFY(!EventLog::parseLimits("branch=1", limits));
+
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      Graph graph(":/test_problems/atest2.txt");
+      PSettings pset;
+      pset.verbose = true;
+      pset.log_path = dir.filePath("events.ptev");
+      pset.log_limits = "leaf=1:0";
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+
+      QBuffer text;
+      text.open(QIODevice::WriteOnly);
+      QVERIFY(EventLog::decode(pset.log_path, text));
+      QList<QByteArray> lines = text.data().split('\n');
+      quint64 leaves = 0;
+      for (const QByteArray &line : lines) {
+        if (line.contains(" leaf depth ")) {
+          leaves++;
+          QVERIFY(line.contains(QByteArray::number(graph.numBlocks())));
+        }
+      }
+      QCOMPARE(leaves, results.visited_leaves);
+
+      // leaves sampled one in two
+      pset.log_limits = "leaf=2:0";
+      pset.log_text = true;
+      pset.log_path = dir.filePath("events.txt");
+      results = JobRunner::global()->submit(graph, pset).result();
+      QFile f(pset.log_path);
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      QCOMPARE((quint64)f.readAll().count(" leaf depth "),
+          (results.visited_leaves + 1) / 2);
+    }
+
+    //! Test that hardware counters are optional and add up over threads.
+    void testHwCounters()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      HwCounters a, b;
+      QVERIFY(!a.isValid());
+      QCOMPARE(a.ipc(), -1.);
+      a.values[HwCounters::Cycles] = 100;
+      a.values[HwCounters::Instructions] = 250;
+      b.values[HwCounters::Cycles] = 100;
+      b.values[HwCounters::Instructions] = 150;
+      b.values[HwCounters::CacheMisses] = 7;
+      a.merge(b);
+      QCOMPARE(a.ipc(), 2.);
+      QCOMPARE(a.perNode(HwCounters::Instructions, 100), 4.);
+      QVERIFY(!a.available(HwCounters::CacheMisses));
+
+      // runs go ahead whether or not the kernel grants the counters
+      Graph graph(":/test_problems/atest3.txt");
+      PSettings pset;
+      pset.threads = 2;
+      PResults plain = JobRunner::global()->submit(graph, pset).result();
+      pset.hw_counters = true;
+      PResults counted = JobRunner::global()->submit(graph, pset).result();
+      QCOMPARE(counted.best_cut_size, plain.best_cut_size);
+      QCOMPARE(counted.thread_hw.size(), counted.threads);
+      if (counted.hw.available(HwCounters::Instructions)) {
+        QVERIFY(counted.hw.values[HwCounters::Instructions] > 0);
+        QVERIFY(PJson::resultsToJson(counted)["hw_counters"].toObject()
+            .contains("instructions_per_node"));
+      }
+    }
+
+    //! Test that heap activity is attributed to threads and phases.
+    void testAllocAccounting()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      AllocCounts before = AllocAccounting::threadCounts(AllocAccounting::Load);
+      {
+        AllocAccounting::Scope scope(AllocAccounting::Load);
+        QVector<int> v(1000);
+        v[0] = 1;
+      }
+      AllocCounts load = AllocAccounting::threadCounts(AllocAccounting::Load) - before;
+
+      Graph graph(":/test_problems/atest3.txt");
+      PSettings pset;
+      pset.threads = 2;
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      if (!AllocAccounting::enabled()) {
+        QCOMPARE(load.allocs, (quint64)0);
+        QCOMPARE(results.search_allocs.allocs, (quint64)0);
+        QVERIFY(!PJson::resultsToJson(results).contains("allocs"));
+        return;
+      }
+      QVERIFY(load.allocs >= 1);
+      QVERIFY(load.bytes >= 1000 * sizeof(int));
+      QCOMPARE(results.thread_allocs.size(), results.threads);
+      QVERIFY(results.search_allocs.allocs > 0);
+      QVERIFY(results.steady_allocs.allocs <= results.search_allocs.allocs);
+      QVERIFY(PJson::resultsToJson(results)["allocs"].toObject()
+          .contains("steady_state"));
+    }
+
+    //! Test that traces hold a named track and a search span per worker.
+    void testTrace()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      QTemporaryDir dir;
+      QVERIFY(dir.isValid());
+      PSettings pset;
+      pset.threads = 2;
+      pset.trace_path = dir.filePath("trace.json");
+      Graph graph(":/test_problems/atest3.txt");
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      QVERIFY(results.best_cut_size >= 0);
+
+      QFile f(pset.trace_path);
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      QJsonParseError err;
+      QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &err);
+      QCOMPARE(err.error, QJsonParseError::NoError);
+      QJsonArray events = doc.object().value("traceEvents").toArray();
+      QSet<int> named, searched;
+      for (const QJsonValue &val : events) {
+        QJsonObject e = val.toObject();
+        if (e["name"].toString() == "thread_name") {
+          named.insert(e["tid"].toInt());
+        } else if (e["ph"].toString() == "X" && e["name"].toString() == "search") {
+          QVERIFY(e["dur"].toDouble() >= 0);
+          searched.insert(e["tid"].toInt());
+        }
+      }
+      // workers take the first slots and the main thread the last
+      QCOMPARE(named.size(), results.threads + 1);
+      QCOMPARE(searched.size(), results.threads);
+      QVERIFY(!searched.contains(results.threads));
+    }
+
+    //! Test that re-solves warm-started from a previous solution stay optimal.
+    void testIncremental()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      Graph graph(":/test_problems/atest2.txt");
+      PResults prev_results = JobRunner::global()->submit(graph, PSettings()).result();
+      PreviousSolution prev;
+      prev.assignment = prev_results.best_assignment;
+      prev.cut_size = prev_results.best_cut_size;
+      prev.proven_optimal = prev_results.proven_optimal;
+
+      // an empty diff is settled by the known bound alone
+      NetlistDiff diff;
+      PSettings pset = Incremental::warmStart(graph, graph, diff, 0, prev,
+          PSettings());
+      QCOMPARE(pset.known_lower_bound, prev.cut_size);
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      QCOMPARE(results.stop_reason, BoundReached);
+      QVERIFY(results.proven_optimal);
+      QCOMPARE(results.best_cut_size, prev.cut_size);
+
+      // an edited netlist gives the same optimum as solving from scratch
+      diff.added_nets.append({0, graph.numBlocks() - 1});
+      diff.removed_nets.append(graph.net(0).toVector());
+      int removed_count = 0;
+      Graph new_graph = diff.apply(graph, &removed_count);
+      QVERIFY(new_graph.isValid());
+      QCOMPARE(removed_count, 1);
+      QCOMPARE(new_graph.numNets(), graph.numNets());
+      pset = Incremental::warmStart(graph, new_graph, diff, removed_count, prev,
+          PSettings());
+      QCOMPARE(pset.incumbent.size(), new_graph.numBlocks());
+      QVERIFY(qAbs(pset.incumbent.count(0) - pset.incumbent.count(1)) <= 1);
+      results = JobRunner::global()->submit(new_graph, pset).result();
+      PResults scratch = JobRunner::global()->submit(new_graph, PSettings()).result();
+      QVERIFY(results.proven_optimal);
+      QCOMPARE(results.best_cut_size, scratch.best_cut_size);
+    }
+
+    //! Test that synthetic netlists are reproducible and follow their settings.
+    void testGenerator()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      GenSettings gen;
+      QVERIFY(GenSettings::fromSpec("blocks=200,nets=300,min_size=2,max_size=8,"
+            "rent=0.6,seed=7", gen));
+      QVERIFY(!GenSettings::fromSpec("blocks=200,colour=red", gen));
+      Graph graph = Generator(gen).generate();
+      QVERIFY(graph.isValid());
+      QCOMPARE(graph.numBlocks(), 200);
+      QCOMPARE(graph.numNets(), 300);
+      QVERIFY(graph.allBlocksConnected());
+      for (int nid=0; nid<graph.numNets(); nid++) {
+        QVERIFY(graph.net(nid).size() >= 2 && graph.net(nid).size() <= 8);
+      }
+
+      // the same settings give the same file, another seed doesn't
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      QVERIFY(graph.writeText(tmp_dir.filePath("a.txt")));
+      QVERIFY(Generator(gen).generate().writeText(tmp_dir.filePath("b.txt")));
+      gen.seed = 8;
+      QVERIFY(Generator(gen).generate().writeText(tmp_dir.filePath("c.txt")));
+      auto contents = [&tmp_dir](const QString &name) {
+        QFile f(tmp_dir.filePath(name));
+        f.open(QIODevice::ReadOnly);
+        return f.readAll();
+      };
+      QCOMPARE(contents("a.txt"), contents("b.txt"));
+      QVERIFY(contents("a.txt") != contents("c.txt"));
+      QCOMPARE(Graph(tmp_dir.filePath("a.txt")).canonicalHash(),
+          graph.canonicalHash());
+
+      // fully affine clusters keep every net inside its cluster
+      QVERIFY(GenSettings::fromSpec("rent=1,clusters=4,affinity=1", gen));
+      graph = Generator(gen).generate();
+      int cluster_size = gen.num_blocks / gen.num_clusters;
+      for (int nid=0; nid<graph.numNets(); nid++) {
+        IdSpan net = graph.net(nid);
+        for (int bid : net) {
+          QCOMPARE(bid / cluster_size, net[0] / cluster_size);
+        }
+      }
+    }
+
+    //! Test that benchmark reports flag regressions against a baseline.
+    void testBench()
+    {
+      using namespace pt;
+
+      BenchSuite suite({":/test_problems/atest2.txt"}, {{"default", PSettings()}},
+          {1, 2});
+      QVERIFY(suite.run());
+      QCOMPARE(suite.runs().size(), 2);
+      QCOMPARE(suite.runs()[0].efficiency, suite.runs()[0].speedup);
+      QJsonObject report = suite.toJson();
+      QCOMPARE(report["runs"].toArray().size(), 2);
+      QVERIFY(BenchSuite::compare(report, report, 0.1).isEmpty());
+
+      // a baseline twice as fast is a regression, a noisy one isn't
+      QJsonObject baseline = report;
+      QJsonArray runs = baseline["runs"].toArray();
+      QJsonObject run = runs[0].toObject();
+      run["wall_time"] = 100.;
+      runs[0] = run;
+      baseline["runs"] = runs;
+      run = report["runs"].toArray()[0].toObject();
+      run["wall_time"] = 200.;
+      runs[0] = run;
+      report["runs"] = runs;
+      QCOMPARE(BenchSuite::compare(report, baseline, 0.1).size(), 1);
+      QVERIFY(BenchSuite::compare(report, baseline, 0.1, 500).isEmpty());
+      QVERIFY(BenchSuite::compare(report, baseline, 1.5).isEmpty());
+
+      // cached results would be benchmarked instead of searches
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      PSettings cached;
+      cached.cache_dir = tmp_dir.path();
+      BenchSuite cache_suite({":/test_problems/atest2.txt"}, {{"cached", cached}},
+          {1, 1});
+      QVERIFY(cache_suite.run());
+      for (const BenchRun &cache_run : cache_suite.runs()) {
+        QVERIFY(!cache_run.results.cached);
+      }
+    }
+
+    //! Test the summary statistics of repeated measurements.
+    void testSampleStats()
+    {
+      using namespace pt;
+
+      SampleStats stats = SampleStats::of({4, 1, 3, 2});
+      QCOMPARE(stats.count, 4);
+      QCOMPARE(stats.min, 1.);
+      QCOMPARE(stats.max, 4.);
+      QCOMPARE(stats.median, 2.5);
+      QCOMPARE(stats.mean, 2.5);
+      QVERIFY(qAbs(stats.stddev - std::sqrt(5. / 3)) < 1e-12);
+      QCOMPARE(SampleStats::of({7}).stddev, 0.);
+      QCOMPARE(SampleStats::of({}).cv(), 0.);
+    }
+
+    //! Test that repeated runs are summarized and flagged when unreliable.
+    void testRepeat()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      GraphPtr graph(new Graph(":/test_problems/baby.txt"));
+      RepeatRunner runner(graph, PSettings());
+      RepeatReport report = runner.run(3, 1);
+      QCOMPARE(report.runs.size(), 3);
+      QCOMPARE(report.wall_time.count, 3);
+      QCOMPARE(report.node_rate.count, 3);
+      for (const PResults &results : report.runs) {
+        QCOMPARE(results.best_cut_size, report.runs[0].best_cut_size);
+      }
+
+      // the tiny problem finishes well within timer resolution
+      QVERIFY(!report.isReliable());
+      QJsonObject obj = report.toJson();
+      QCOMPARE(obj["repeats"].toInt(), 3);
+      QCOMPARE(obj["runs"].toArray().size(), 3);
+      QVERIFY(!obj["reliable"].toBool());
+    }
+
+    //! Test that a batch writes one row per netlist.
+    void testBatch()
+    {
+      using namespace pt;
+
+      QStringList in_paths = BatchRunner::collectInputs(":/test_problems");
+      QCOMPARE(in_paths.size(), 4);
+
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      QString out_path = tmp_dir.filePath("results.jsonl");
+      BatchRunner batch(out_path, 2);
+      QCOMPARE(batch.run(in_paths, PSettings()), 0);
+
+      QFile f(out_path);
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      int rows = 0;
+      while (!f.atEnd()) {
+        QJsonObject row = QJsonDocument::fromJson(f.readLine()).object();
+        QString props_path = row["file"].toString().replace(".txt", "_props.json");
+        QCOMPARE(row["best_cut_size"].toInt(),
+            readTestProps(props_path)["cut_size"].toInt());
+        rows++;
+      }
+      QCOMPARE(rows, in_paths.size());
+    }
+
+    //! Test that the daemon serves jobs and caches parsed netlists.
+    void testDaemon()
+    {
+      using namespace pt;
+
+      PartitionDaemon daemon;
+      QString socket_name = QString("partitioner_tests_%1")
+        .arg(QCoreApplication::applicationPid());
+      QVERIFY(daemon.listen(socket_name));
+
+      QLocalSocket client;
+      QList<QJsonObject> replies;
+      connect(&client, &QLocalSocket::readyRead, [&client, &replies]() {
+          while (client.canReadLine()) {
+            replies.append(QJsonDocument::fromJson(client.readLine()).object());
+          }
+        });
+      client.connectToServer(socket_name);
+      QVERIFY(client.waitForConnected(1000));
+
+      // the same netlist twice, the second should hit the graph cache
+      QFile f(":/test_problems/baby.txt");
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      QJsonObject request;
+      request["netlist"] = QString::fromUtf8(f.readAll());
+      for (int id : {1, 2}) {
+        request["id"] = id;
+        client.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+      }
+      client.flush();
+
+      auto resultCount = [&replies]() {
+        int count = 0;
+        for (const QJsonObject &reply : replies) {
+          count += (reply["type"].toString() == "result") ? 1 : 0;
+        }
+        return count;
+      };
+      QTRY_COMPARE_WITH_TIMEOUT(resultCount(), 2, 10000);
+      int expected_cut = readTestProps(":/test_problems/baby_props.json")
+        ["cut_size"].toInt();
+      for (const QJsonObject &reply : replies) {
+        if (reply["type"].toString() == "accepted") {
+          QCOMPARE(reply["cached"].toBool(), reply["id"].toInt() == 2);
+        } else {
+          QCOMPARE(reply["type"].toString(), QString("result"));
+          QCOMPARE(reply["best_cut_size"].toInt(), expected_cut);
+        }
+      }
+
+      // settings naming files and paths outside of a netlist root are refused
+      replies.clear();
+      QJsonObject file_setting = request;
+      file_setting["id"] = 3;
+      QJsonObject ckpt_setting;
+      ckpt_setting["checkpoint_path"] = QString("daemon.ckpt");
+      file_setting["settings"] = ckpt_setting;
+      QJsonObject path_request;
+      path_request["id"] = 4;
+      path_request["path"] = QString("/etc/passwd");
+      for (const QJsonObject &refused : {file_setting, path_request}) {
+        client.write(QJsonDocument(refused).toJson(QJsonDocument::Compact) + "\n");
+      }
+      client.flush();
+      QTRY_COMPARE_WITH_TIMEOUT(replies.size(), 2, 10000);
+      for (const QJsonObject &reply : replies) {
+        QCOMPARE(reply["type"].toString(), QString("error"));
+      }
+    }
+
+    //! Test that the canonical hash ignores net and block order.
+    void testCanonicalHash()
+    {
+      using namespace sp;
+
+      Graph graph = Graph::fromText("4 3\n2 0 1\n3 1 2 3\n2 0 3\n");
+      Graph permuted = Graph::fromText("4 3\n2 3 0\n2 1 0\n3 3 2 1\n");
+      Graph different = Graph::fromText("4 3\n2 0 2\n3 1 2 3\n2 0 3\n");
+      QVERIFY(graph.isValid() && permuted.isValid() && different.isValid());
+      QCOMPARE(graph.canonicalHash(), permuted.canonicalHash());
+      QVERIFY(graph.canonicalHash() != different.canonicalHash());
+    }
+
+    //! Test that the parser accepts loose whitespace and rejects malformed headers and nets.
+    void testParseErrors()
+    {
+      using namespace sp;
+
+      Graph loose = Graph::fromText("3 2\r\n2  0 1 \r\n\t2 1 2\r\n");
+      QVERIFY(loose.isValid());
+      QCOMPARE(loose.numNets(), 2);
+      QCOMPARE(loose.net(1).toVector(), QVector<int>({1, 2}));
+      QVERIFY(!Graph::fromText("3 2\n2 0 1\n2 1 x\n").isValid());
+      QVERIFY(!Graph::fromText("3 2\n2 0 1\n2 1 3\n").isValid());
+      QVERIFY(!Graph::fromText("3 2\n3 0 1\n2 1 2\n").isValid());
+      QVERIFY(!Graph::fromText("3\n2 0 1\n").isValid());
+      QVERIFY(!Graph::fromText("3 3\n2 0 1\n2 1 2\n").isValid());
+      QVERIFY(!Graph::fromText("3 2000000000\n2 0 1\n").isValid());
+      QVERIFY(!Graph::fromText("2000000000 1\n2 0 1\n").isValid());
+    }
+
+    //! Test that renumbering nets keeps the graph and its costs intact.
+    void testLocalNetOrder()
+    {
+      using namespace sp;
+
+      Graph graph = Graph::fromText("4 3\n2 2 3\n2 0 1\n3 1 2 3\n");
+      Graph ordered = graph.withLocalNetOrder();
+      QVERIFY(ordered.isValid());
+      QCOMPARE(ordered.numPins(), graph.numPins());
+      QCOMPARE(ordered.net(0).toVector(), QVector<int>({0, 1}));
+      QCOMPARE(ordered.blockNets(1).toVector(), QVector<int>({0, 1}));
+      QCOMPARE(ordered.canonicalHash(), graph.canonicalHash());
+      QVector<int> assignment({0, 1, 1, 0});
+      QCOMPARE(Chip::calcCost(ordered, assignment), Chip::calcCost(graph, assignment));
+      QVERIFY(!graph.hasLocalNetOrder());
+      QVERIFY(ordered.hasLocalNetOrder());
+      QVERIFY(ordered.withLocalNetOrder().hasLocalNetOrder());
+    }
+
+    //! Test that binary netlists load back into the same graph.
+    void testBinaryNetlist()
+    {
+      using namespace sp;
+
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      Graph graph(":/test_problems/atest3.txt");
+      QString bin_path = tmp_dir.filePath("atest3.ptnl");
+      QVERIFY(graph.writeBinary(bin_path));
+
+      Graph loaded(bin_path);
+      QVERIFY(loaded.isValid());
+      QCOMPARE(loaded.numBlocks(), graph.numBlocks());
+      QCOMPARE(loaded.numNets(), graph.numNets());
+      for (int nid=0; nid<graph.numNets(); nid++) {
+        QCOMPARE(loaded.net(nid).toVector(), graph.net(nid).toVector());
+      }
+      for (int bid=0; bid<graph.numBlocks(); bid++) {
+        QCOMPARE(loaded.blockNets(bid).toVector(), graph.blockNets(bid).toVector());
+      }
+      QCOMPARE(loaded.canonicalHash(), graph.canonicalHash());
+
+      // a stale stored hash is not trusted
+      QFile f(bin_path);
+      QVERIFY(f.open(QIODevice::ReadWrite));
+      QVERIFY(f.seek(6*4));
+      QVERIFY(f.write(QByteArray(32, '\0')) == 32);
+      f.close();
+      Graph stale(bin_path);
+      QVERIFY(stale.isValid());
+      QCOMPARE(stale.canonicalHash(), graph.canonicalHash());
+
+      // corrupted payloads and truncated files are rejected
+      QVERIFY(f.open(QIODevice::ReadWrite));
+      QVERIFY(f.seek(f.size() - 4));
+      QByteArray last = f.read(4);
+      last[0] = last[0] ^ 1;
+      QVERIFY(f.seek(f.size() - 4));
+      QVERIFY(f.write(last) == 4);
+      f.close();
+      QVERIFY(!Graph(bin_path).isValid());
+      QVERIFY(f.open(QIODevice::ReadWrite));
+      QVERIFY(f.resize(f.size() - 4));
+      f.close();
+      QVERIFY(!Graph(bin_path).isValid());
+    }
+
+    //! Test that proven results are served from the result cache.
+    void testResultCache()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      Graph graph(":/test_problems/baby.txt");
+      int expected_cut = readTestProps(":/test_problems/baby_props.json")
+        ["cut_size"].toInt();
+      PSettings pset;
+      pset.cache_dir = tmp_dir.path();
+
+      PResults first = JobRunner::global()->submit(graph, pset).result();
+      QVERIFY(!first.cached);
+      QCOMPARE(first.best_cut_size, expected_cut);
+      PResults second = JobRunner::global()->submit(graph, pset).result();
+      QVERIFY(second.cached);
+      QVERIFY(second.proven_optimal);
+      QCOMPARE(second.best_cut_size, expected_cut);
+      QCOMPARE(Chip::calcCost(graph, second.best_assignment), expected_cut);
+
+      // entries that don't match the graph count as misses
+      ResultCache cache(tmp_dir.path());
+      ResultCache::Entry entry;
+      QVERIFY(cache.lookup(graph.canonicalHash(), graph, entry));
+      QVERIFY(!cache.lookup(graph.canonicalHash(),
+            Graph(":/test_problems/atest3.txt"), entry));
+      QFile entry_file(tmp_dir.filePath(
+            QString::fromLatin1(graph.canonicalHash().toHex()) + ".json"));
+      QVERIFY(entry_file.open(QIODevice::WriteOnly));
+      entry_file.write(QString("{\"cut_size\":0,\"proven_optimal\":true,"
+            "\"assignment\":[]}").toUtf8());
+      entry_file.close();
+      QVERIFY(!cache.lookup(graph.canonicalHash(), graph, entry));
+      PResults third = JobRunner::global()->submit(graph, pset).result();
+      QVERIFY(!third.cached);
+      QCOMPARE(third.best_cut_size, expected_cut);
+    }
+
+    //! Test that budgets stop the search early with a valid lower bound.
+    void testSearchBudgets()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      Graph graph(":/test_problems/baby.txt");
+      PSettings pset;
+      pset.node_limit = 1;
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      QCOMPARE(results.stop_reason, NodeLimit);
+      QVERIFY(!results.proven_optimal);
+      QVERIFY(results.lower_bound >= 0);
+      QVERIFY(results.lower_bound <= readTestProps(
+            ":/test_problems/baby_props.json")["cut_size"].toInt());
+    }
+
+    //! Test that trees with more than 2^64 leaves are accounted correctly.
+    void testLargeGraph()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      // a chain of 100 blocks
+      QVector<QVector<int>> nets;
+      for (int bid=0; bid<99; bid++) {
+        nets.append({bid, bid+1});
+      }
+      GraphPtr graph(new Graph(Graph::fromNets(100, nets)));
+      QVERIFY(graph->isValid());
+
+      PSettings pset;
+      pset.threads = 4;
+      pset.node_limit = 5000;
+      PResults results = JobRunner::global()->submit(graph, pset).result();
+      QCOMPARE(results.stop_reason, NodeLimit);
+      QVERIFY(results.best_cut_size >= 1);
+      QVERIFY(results.lower_bound >= 0 && results.lower_bound <= 1);
+      // the mirrored half of the tree alone holds 2^99 leaves
+      QVERIFY(results.pruned_leaves >= std::ldexp(1., 99));
+      QVERIFY(std::isfinite(results.pruned_leaves));
+    }
+
+    //! Test that checkpoints survive a round trip and can be resumed from.
+    void testCheckpointResume()
+    {
+      using namespace sp;
+      using namespace pt;
+
+      QString base_name = ":/test_problems/baby";
+      QVariantMap expected_props = readTestProps(base_name + "_props.json");
+      Graph graph(base_name + ".txt");
+
+      // a checkpoint holding the untouched left half of the tree
+      Checkpoint ckpt;
+      ckpt.num_blocks = graph.numBlocks();
+      ckpt.num_nets = graph.numNets();
+      ckpt.graph_hash = graph.canonicalHash();
+      ckpt.visited_leaves = 3;
+      QVector<int> root(graph.numBlocks(), -1);
+      root[0] = 0;
+      ckpt.frontier.append(ProblemNodeParams::fromPrefix(root, 1,
+            QVector<int>(graph.numNets(), -1)));
+
+      QTemporaryDir tmp_dir;
+      QVERIFY(tmp_dir.isValid());
+      QString ckpt_path = tmp_dir.filePath("baby.ckpt");
+      QVERIFY(ckpt.write(ckpt_path));
+
+      Checkpoint read_ckpt;
+      QVERIFY(Checkpoint::read(ckpt_path, read_ckpt));
+      QCOMPARE(read_ckpt.num_blocks, ckpt.num_blocks);
+      QCOMPARE(read_ckpt.graph_hash, ckpt.graph_hash);
+      QVERIFY(read_ckpt.graph_hash
+          != Graph(":/test_problems/atest3.txt").canonicalHash());
+      QCOMPARE(read_ckpt.visited_leaves, ckpt.visited_leaves);
+      QCOMPARE(read_ckpt.frontier.size(), 1);
+      QCOMPARE(read_ckpt.frontier[0].bid, 1);
+      QCOMPARE(read_ckpt.frontier[0].assignment, root);
+
+      // resuming from the checkpoint gives the same optimum for any threads
+      for (int threads : {1, 2, 4}) {
+        PSettings pset;
+        pset.threads = threads;
+        pset.resume_path = ckpt_path;
+        PResults results = JobRunner::global()->submit(graph, pset).result();
+        QCOMPARE(results.best_cut_size, expected_props["cut_size"].toInt());
       }
     }
 };